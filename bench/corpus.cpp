@@ -0,0 +1,67 @@
+#include "corpus.hpp"
+#include <fmt/format.h>
+
+Corpus deep_nesting(size_t size, size_t depth) {
+  std::string source = "0";
+  for (size_t i = 0; source.size() < size; ++i) {
+    source += " + ";
+    source.append(depth, '(');
+    source += "1";
+    for (size_t j = 0; j < depth; ++j)
+      source += fmt::format(" {} {})", "+-*"[(i + j) % 3], j % 9 + 1);
+  }
+  return {"deep_nesting", std::move(source), true};
+}
+
+Corpus long_strings(size_t size, size_t length) {
+  std::string source;
+  for (size_t i = 0; source.size() < size; ++i) {
+    if (i > 0)
+      source += " == ";
+    source += '"';
+    for (size_t j = 0; j < length; ++j)
+      source += static_cast<char>('a' + (i + j) % 26);
+    source += '"';
+  }
+  return {"long_strings", std::move(source), true};
+}
+
+Corpus identifier_heavy(size_t size) {
+  static constexpr const char *words[] = {
+      "alpha", "beta_2",  "and",   "gamma", "class",  "delta", "or",
+      "print", "epsilon", "while", "zeta",  "return", "_eta",  "this"};
+  std::string source;
+  for (size_t i = 0; source.size() < size; ++i)
+    source += fmt::format("{} {} ", words[i % std::size(words)],
+                          i % 5 == 0 ? "." : "+");
+  return {"identifier_heavy", std::move(source), false};
+}
+
+Corpus numeric_heavy(size_t size) {
+  std::string source = "0";
+  for (size_t i = 0; source.size() < size; ++i)
+    source += fmt::format(" {} {}.{}", "+-*/"[i % 4], i % 1000 + 1, i % 97);
+  return {"numeric_heavy", std::move(source), true};
+}
+
+Corpus comment_heavy(size_t size) {
+  std::string source = "0";
+  for (size_t i = 0; source.size() < size; ++i) {
+    if (i % 2 == 0)
+      source += fmt::format(" // running total, step {} of the sum\n", i);
+    else
+      source += fmt::format(" /* adds {}\n    to the sum */", i % 10);
+    source += fmt::format(" + {}", i % 10);
+  }
+  return {"comment_heavy", std::move(source), true};
+}
+
+std::vector<Corpus> all_corpora(size_t size) {
+  std::vector<Corpus> corpora;
+  corpora.push_back(deep_nesting(size));
+  corpora.push_back(long_strings(size));
+  corpora.push_back(identifier_heavy(size));
+  corpora.push_back(numeric_heavy(size));
+  corpora.push_back(comment_heavy(size));
+  return corpora;
+}
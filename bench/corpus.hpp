@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Synthetic source for the benchmarks, built to be roughly size bytes
+struct Corpus {
+  std::string name;
+  std::string source;
+  // Whether the source is an expression the parser and interpreter accept,
+  // identifiers aren't yet
+  bool evaluates;
+};
+
+// Groups nested depth deep, chained with '+'
+Corpus deep_nesting(size_t size, size_t depth = 256);
+// String literals of length bytes compared with "=="
+Corpus long_strings(size_t size, size_t length = 4096);
+// Identifiers and keywords separated by operators
+Corpus identifier_heavy(size_t size);
+// Integer and decimal literals under all arithmetic operators
+Corpus numeric_heavy(size_t size);
+// Short expressions between line and block comments
+Corpus comment_heavy(size_t size);
+
+std::vector<Corpus> all_corpora(size_t size);
@@ -0,0 +1,189 @@
+#include "corpus.hpp"
+#include "report.hpp"
+#include <chrono>
+#include <charconv>
+#include <cstdio>
+#include <flat_ast.hpp>
+#include <fmt/format.h>
+#include <interpreter.hpp>
+#include <parser.hpp>
+#include <scanner.hpp>
+#include <source_file.hpp>
+#include <string_view>
+
+namespace {
+struct Options {
+  size_t size = 1 << 20;
+  std::string_view corpus;
+  std::string_view stage;
+  double min_seconds = 0.5;
+  size_t min_iterations = 5;
+  std::string_view output;
+  std::string_view baseline;
+  double threshold = 0.1;
+};
+
+constexpr std::string_view usage = R"(usage: jlox-bench [options]
+  --size BYTES        size of each generated corpus (default 1048576)
+  --corpus NAME       only run the corpus NAME
+  --stage NAME        only run tokenize, tokenize_dfa, parse or interpret
+  --min-time SECONDS  time spent on each benchmark at least (default 0.5)
+  --output FILE       write the results as JSON to FILE
+  --compare FILE      compare against the JSON results in FILE, exits with 1
+                      on a regression
+  --threshold RATIO   slowdown counted as regression (default 0.1)
+)";
+
+template <typename T> bool parse_number(std::string_view text, T &value) {
+  auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (i + 1 == argc)
+      return false;
+    std::string_view value = argv[++i];
+    bool ok = true;
+    if (arg == "--size")
+      ok = parse_number(value, options.size);
+    else if (arg == "--corpus")
+      options.corpus = value;
+    else if (arg == "--stage")
+      options.stage = value;
+    else if (arg == "--min-time")
+      ok = parse_number(value, options.min_seconds);
+    else if (arg == "--output")
+      options.output = value;
+    else if (arg == "--compare")
+      options.baseline = value;
+    else if (arg == "--threshold")
+      ok = parse_number(value, options.threshold);
+    else
+      ok = false;
+    if (!ok)
+      return false;
+  }
+  return true;
+}
+
+// Keeps the optimizer from dropping a result nobody reads
+template <typename T> void keep(const T &value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+template <typename Run>
+BenchResult measure(const Corpus &corpus, std::string_view stage,
+                    const Options &options, Run run) {
+  using Clock = std::chrono::steady_clock;
+  keep(run());
+  BenchResult result{corpus.name, std::string(stage), corpus.source.size(),
+                     0, 0, 0};
+  double total_ns = 0;
+  while (result.iterations < options.min_iterations ||
+         total_ns < options.min_seconds * 1e9) {
+    auto start = Clock::now();
+    keep(run());
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    total_ns += elapsed.count();
+    if (result.iterations == 0 || elapsed.count() < result.min_ns)
+      result.min_ns = elapsed.count();
+    ++result.iterations;
+  }
+  result.mean_ns = total_ns / static_cast<double>(result.iterations);
+  return result;
+}
+
+std::vector<BenchResult> run_corpus(const Corpus &corpus,
+                                    const Options &options) {
+  std::vector<BenchResult> results;
+  auto wanted = [&](std::string_view stage) {
+    return options.stage.empty() || options.stage == stage;
+  };
+  std::string_view src = corpus.source;
+  for (auto backend : {ScanBackend::Switch, ScanBackend::Dfa}) {
+    auto stage = backend == ScanBackend::Dfa ? "tokenize_dfa" : "tokenize";
+    if (!wanted(stage))
+      continue;
+    Scanner scanner(backend);
+    results.push_back(measure(corpus, stage, options, [&] {
+      size_t count = 0;
+      for (auto &token : scanner.tokenize_compact(src))
+        count += token.has_value();
+      return count;
+    }));
+  }
+  if (!corpus.evaluates)
+    return results;
+
+  Scanner scanner;
+  Parser parser;
+  FlatAst ast;
+  if (wanted("parse")) {
+    results.push_back(measure(corpus, "parse", options, [&] {
+      ast.reset();
+      return parser.parse(scanner.tokenize_compact(src), src, ast);
+    }));
+  }
+  if (wanted("interpret")) {
+    ast.reset();
+    parser.parse(scanner.tokenize_compact(src), src, ast);
+    results.push_back(measure(corpus, "interpret", options,
+                              [&] { return Interpreter()(ast); }));
+  }
+  return results;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_options(argc, argv, options)) {
+    fmt::print(stderr, "{}", usage);
+    return 2;
+  }
+
+  std::vector<BenchResult> results;
+  fmt::print("{:<18} {:<14} {:>12} {:>12} {:>10}\n", "corpus", "stage",
+             "min ms", "mean ms", "MB/s");
+  for (const auto &corpus : all_corpora(options.size)) {
+    if (!options.corpus.empty() && options.corpus != corpus.name)
+      continue;
+    for (auto &result : run_corpus(corpus, options)) {
+      fmt::print("{:<18} {:<14} {:>12.3f} {:>12.3f} {:>10.1f}\n",
+                 result.corpus, result.stage, result.min_ns / 1e6,
+                 result.mean_ns / 1e6, result.megabytes_per_second());
+      results.push_back(std::move(result));
+    }
+  }
+
+  if (!options.output.empty()) {
+    auto file = std::fopen(std::string(options.output).c_str(), "w");
+    if (!file) {
+      fmt::print(stderr, "cannot write {}\n", options.output);
+      return 2;
+    }
+    fmt::print(file, "{}", to_json(results));
+    std::fclose(file);
+  }
+
+  if (options.baseline.empty())
+    return 0;
+  auto baseline_file = SourceFile::open(options.baseline);
+  if (!baseline_file) {
+    fmt::print(stderr, "cannot read {}: {}\n", options.baseline,
+               baseline_file.error().message());
+    return 2;
+  }
+  auto baseline = read_results(baseline_file->contents());
+  auto regressions = find_regressions(baseline, results, options.threshold);
+  for (const auto &regression : regressions)
+    fmt::print("REGRESSION {} {}: {:.3f} ms -> {:.3f} ms ({:+.1f}%)\n",
+               regression.current->corpus, regression.current->stage,
+               regression.baseline->min_ns / 1e6,
+               regression.current->min_ns / 1e6,
+               (regression.ratio - 1) * 100);
+  fmt::print("{} regressions against {} baseline results\n",
+             regressions.size(), baseline.size());
+  return regressions.empty() ? 0 : 1;
+}
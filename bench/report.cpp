@@ -0,0 +1,88 @@
+#include "report.hpp"
+#include <charconv>
+#include <fmt/format.h>
+#include <optional>
+
+namespace {
+std::optional<std::string_view> field(std::string_view line,
+                                      std::string_view name) {
+  auto key = fmt::format("\"{}\": ", name);
+  auto start = line.find(key);
+  if (start == std::string_view::npos)
+    return std::nullopt;
+  line.remove_prefix(start + key.size());
+  if (line.starts_with('"')) {
+    auto end = line.find('"', 1);
+    if (end == std::string_view::npos)
+      return std::nullopt;
+    return line.substr(1, end - 1);
+  }
+  return line.substr(0, line.find_first_of(",}"));
+}
+
+template <typename T>
+bool number_field(std::string_view line, std::string_view name, T &value) {
+  auto text = field(line, name);
+  if (!text)
+    return false;
+  auto [ptr, ec] =
+      std::from_chars(text->data(), text->data() + text->size(), value);
+  return ec == std::errc();
+}
+} // namespace
+
+std::string to_json(const std::vector<BenchResult> &results) {
+  std::string json = "[\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto &r = results[i];
+    json += fmt::format(
+        "  {{\"corpus\": \"{}\", \"stage\": \"{}\", \"bytes\": {}, "
+        "\"iterations\": {}, \"mean_ns\": {:.1f}, \"min_ns\": {:.1f}, "
+        "\"mb_per_s\": {:.2f}}}{}\n",
+        r.corpus, r.stage, r.bytes, r.iterations, r.mean_ns, r.min_ns,
+        r.megabytes_per_second(), i + 1 < results.size() ? "," : "");
+  }
+  json += "]\n";
+  return json;
+}
+
+std::vector<BenchResult> read_results(std::string_view json) {
+  std::vector<BenchResult> results;
+  while (!json.empty()) {
+    auto end = json.find('\n');
+    auto line = json.substr(0, end);
+    json.remove_prefix(end == std::string_view::npos ? json.size() : end + 1);
+
+    auto corpus = field(line, "corpus");
+    auto stage = field(line, "stage");
+    BenchResult result{};
+    if (!corpus || !stage || !number_field(line, "bytes", result.bytes) ||
+        !number_field(line, "iterations", result.iterations) ||
+        !number_field(line, "mean_ns", result.mean_ns) ||
+        !number_field(line, "min_ns", result.min_ns))
+      continue;
+    result.corpus = *corpus;
+    result.stage = *stage;
+    results.push_back(std::move(result));
+  }
+  return results;
+}
+
+std::vector<Regression> find_regressions(const std::vector<BenchResult> &baseline,
+                                         const std::vector<BenchResult> &current,
+                                         double threshold) {
+  std::vector<Regression> regressions;
+  for (const auto &now : current) {
+    for (const auto &before : baseline) {
+      if (before.corpus != now.corpus || before.stage != now.stage)
+        continue;
+      // Per byte, the baseline may have been run with another size
+      auto ratio = (now.min_ns / static_cast<double>(now.bytes)) /
+                   (before.min_ns / static_cast<double>(before.bytes));
+      if (ratio > 1 + threshold)
+        regressions.push_back({&before, &now, ratio});
+      break;
+    }
+  }
+  return regressions;
+}
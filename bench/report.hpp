@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct BenchResult {
+  std::string corpus;
+  std::string stage;
+  size_t bytes;
+  size_t iterations;
+  double mean_ns;
+  double min_ns;
+
+  double megabytes_per_second() const noexcept {
+    return static_cast<double>(bytes) / min_ns * 1e3;
+  }
+};
+
+// One result object per line, so read_results can get by without a JSON
+// library
+std::string to_json(const std::vector<BenchResult> &results);
+// Reads what to_json wrote, lines it doesn't understand are skipped
+std::vector<BenchResult> read_results(std::string_view json);
+
+struct Regression {
+  const BenchResult *baseline;
+  const BenchResult *current;
+  // current / baseline of min_ns
+  double ratio;
+};
+
+// Results slower than their baseline by more than threshold, 0.1 is 10%.
+// Min rather than mean times are compared, they are the least noisy.
+std::vector<Regression> find_regressions(const std::vector<BenchResult> &baseline,
+                                         const std::vector<BenchResult> &current,
+                                         double threshold);
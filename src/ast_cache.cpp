@@ -0,0 +1,269 @@
+#include "ast_cache.hpp"
+#include "source_file.hpp"
+#include <bit>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <span>
+#include <unordered_map>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+constexpr char magic[4] = {'J', 'L', 'X', 'A'};
+// Bump whenever FlatNode, the literal encoding or the header change
+constexpr std::uint32_t format_version = 1;
+
+struct Header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t hash;
+  std::uint32_t nodes;
+  std::uint32_t literals;
+  std::uint32_t strings;
+  std::uint32_t string_bytes;
+  std::uint32_t root;
+  std::uint32_t reserved;
+};
+
+struct StoredLiteral {
+  std::uint32_t type;
+  std::uint32_t reserved;
+  // Number: bits of the double, Bool: 0 or 1, String: index into the
+  // string table
+  std::uint64_t payload;
+};
+
+// Each distinct string is stored and interned once per image
+struct StoredString {
+  std::uint32_t offset;
+  std::uint32_t length;
+};
+
+static_assert(std::is_trivially_copyable_v<FlatNode>);
+static_assert(sizeof(Header) == 40 && sizeof(StoredLiteral) == 16 &&
+              sizeof(StoredString) == 8);
+static_assert(std::endian::native == std::endian::little,
+              "images are stored in host byte order");
+
+template <typename T> void append(std::string &out, std::span<const T> values) {
+  out.append(reinterpret_cast<const char *>(values.data()),
+             values.size_bytes());
+}
+
+// Children are always added before their parent, which also rules out cycles
+bool valid_node(const FlatNode &node, std::uint32_t index,
+                std::uint32_t literals) {
+  switch (node.kind) {
+  case NodeKind::Constant:
+    return node.lhs < literals;
+  case NodeKind::Unary:
+    return node.lhs < index;
+  case NodeKind::Binary:
+    return node.lhs < index && node.rhs < index;
+  }
+  return false;
+}
+} // namespace
+
+std::uint64_t source_hash(std::string_view source) noexcept {
+  constexpr std::uint64_t prime = 0x9e3779b97f4a7c15;
+  std::uint64_t hash = 0xcbf29ce484222325 ^ source.size();
+  auto mix = [&hash](std::uint64_t word) {
+    hash = (hash ^ word) * prime;
+    hash ^= hash >> 32;
+  };
+  // A word at a time, sources are hashed on every load
+  size_t i = 0;
+  for (; i + 8 <= source.size(); i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, source.data() + i, sizeof(word));
+    mix(word);
+  }
+  if (i < source.size()) {
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, source.data() + i, source.size() - i);
+    mix(tail);
+  }
+  hash ^= hash >> 29;
+  hash *= 0xbf58476d1ce4e5b9;
+  return hash ^ (hash >> 32);
+}
+
+std::string serialize_ast(const FlatAst &ast, std::uint64_t hash) {
+  auto nodes = ast.nodes();
+  auto literals = ast.literals();
+  std::vector<StoredLiteral> stored;
+  stored.reserve(literals.size());
+  std::vector<StoredString> table;
+  // Interned strings are equal exactly when their Values are
+  std::unordered_map<std::uint64_t, std::uint32_t> indices;
+  std::string strings;
+  for (auto literal : literals) {
+    StoredLiteral entry{static_cast<std::uint32_t>(literal.type()), 0, 0};
+    switch (literal.type()) {
+    case ValueType::Number:
+      entry.payload = std::bit_cast<std::uint64_t>(literal.as_number());
+      break;
+    case ValueType::Bool:
+      entry.payload = literal.as_bool();
+      break;
+    case ValueType::String: {
+      auto [itr, added] = indices.try_emplace(
+          std::bit_cast<std::uint64_t>(literal),
+          static_cast<std::uint32_t>(table.size()));
+      if (added) {
+        auto str = literal.as_string();
+        table.push_back({static_cast<std::uint32_t>(strings.size()),
+                         static_cast<std::uint32_t>(str.size())});
+        strings += str;
+      }
+      entry.payload = itr->second;
+      break;
+    }
+    case ValueType::Nil:
+      break;
+    }
+    stored.push_back(entry);
+  }
+
+  Header header{{},
+                format_version,
+                hash,
+                static_cast<std::uint32_t>(nodes.size()),
+                static_cast<std::uint32_t>(stored.size()),
+                static_cast<std::uint32_t>(table.size()),
+                static_cast<std::uint32_t>(strings.size()),
+                std::to_underlying(ast.root()),
+                0};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  std::string out;
+  out.reserve(sizeof(Header) + nodes.size_bytes() +
+              stored.size() * sizeof(StoredLiteral) +
+              table.size() * sizeof(StoredString) + strings.size());
+  append(out, std::span<const Header>(&header, 1));
+  append(out, nodes);
+  append(out, std::span<const StoredLiteral>(stored));
+  append(out, std::span<const StoredString>(table));
+  out += strings;
+  return out;
+}
+
+bool deserialize_ast(std::string_view bytes, std::uint64_t hash,
+                     FlatAst &ast) {
+  Header header;
+  if (bytes.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+      header.version != format_version || header.hash != hash)
+    return false;
+  auto nodes_size = size_t{header.nodes} * sizeof(FlatNode);
+  auto literals_size = size_t{header.literals} * sizeof(StoredLiteral);
+  auto table_size = size_t{header.strings} * sizeof(StoredString);
+  if (bytes.size() != sizeof(header) + nodes_size + literals_size +
+                          table_size + header.string_bytes)
+    return false;
+  bytes.remove_prefix(sizeof(header));
+
+  // Copied out rather than cast in place, the mapping needn't be aligned
+  std::vector<FlatNode> nodes(header.nodes);
+  if (nodes_size != 0)
+    std::memcpy(nodes.data(), bytes.data(), nodes_size);
+  bytes.remove_prefix(nodes_size);
+  for (std::uint32_t i = 0; i < header.nodes; ++i)
+    if (!valid_node(nodes[i], i, header.literals))
+      return false;
+  auto root = NodeIndex{header.root};
+  if (root != invalid_node && header.root >= header.nodes)
+    return false;
+
+  auto blob = bytes.substr(literals_size + table_size);
+  std::vector<Value> strings;
+  strings.reserve(header.strings);
+  for (std::uint32_t i = 0; i < header.strings; ++i) {
+    StoredString entry;
+    std::memcpy(&entry, bytes.data() + literals_size + i * sizeof(entry),
+                sizeof(entry));
+    if (entry.offset > blob.size() || entry.length > blob.size() - entry.offset)
+      return false;
+    strings.push_back(Value::string(blob.substr(entry.offset, entry.length)));
+  }
+
+  std::vector<Literal> literals;
+  literals.reserve(header.literals);
+  for (std::uint32_t i = 0; i < header.literals; ++i) {
+    StoredLiteral entry;
+    std::memcpy(&entry, bytes.data() + i * sizeof(StoredLiteral),
+                sizeof(entry));
+    switch (static_cast<ValueType>(entry.type)) {
+    case ValueType::Number:
+      literals.push_back(
+          Value::number(std::bit_cast<double>(entry.payload)));
+      break;
+    case ValueType::Bool:
+      literals.emplace_back(entry.payload != 0);
+      break;
+    case ValueType::String:
+      if (entry.payload >= strings.size())
+        return false;
+      literals.push_back(strings[entry.payload]);
+      break;
+    case ValueType::Nil:
+      literals.emplace_back();
+      break;
+    default:
+      return false;
+    }
+  }
+  ast.assign(nodes, literals, root);
+  return true;
+}
+
+AstCache::AstCache(std::filesystem::path directory)
+    : m_directory(std::move(directory)) {
+  std::error_code ec;
+  // A directory which can't be created shows up as failed writes
+  std::filesystem::create_directories(m_directory, ec);
+}
+
+std::filesystem::path AstCache::entry_path(std::uint64_t hash) const {
+  return m_directory / fmt::format("{:016x}.ast", hash);
+}
+
+NodeIndex AstCache::load(std::string_view source, FlatAst &ast) {
+  auto hash = source_hash(source);
+  if (auto file = SourceFile::open(entry_path(hash).string())) {
+    if (deserialize_ast(file->contents(), hash, ast)) {
+      ++m_stats.hits;
+      return ast.root();
+    }
+  }
+  ++m_stats.misses;
+  ast.reset();
+  auto root = m_parser.parse(m_scanner.tokenize_compact(source), source, ast);
+  store(hash, ast);
+  return root;
+}
+
+void AstCache::store(std::uint64_t hash, const FlatAst &ast) {
+  auto path = entry_path(hash);
+  // Unique per process, readers only ever see complete entries
+  auto temporary = path;
+  temporary += fmt::format(".{}.tmp", getpid());
+  auto image = serialize_ast(ast, hash);
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(image.data(), static_cast<std::streamsize>(image.size()));
+    if (!out) {
+      ++m_stats.write_failures;
+      return;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temporary, path, ec);
+  if (ec) {
+    ++m_stats.write_failures;
+    std::filesystem::remove(temporary, ec);
+  }
+}
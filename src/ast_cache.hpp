@@ -0,0 +1,52 @@
+#pragma once
+#include "flat_ast.hpp"
+#include "parser.hpp"
+#include "scanner.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// 64 bit hash of the source, what cache entries are keyed by. Not meant
+// to withstand crafted collisions.
+std::uint64_t source_hash(std::string_view source) noexcept;
+
+// Binary image of a FlatAst: a header, the node table as is, the literals
+// with strings as indices into a table of the distinct strings, and their
+// bytes. No pointers, so it can be mapped anywhere and read back in one
+// pass.
+std::string serialize_ast(const FlatAst &ast, std::uint64_t hash);
+// Loads an image of serialize_ast into ast. Returns false, leaving ast
+// alone, when bytes are truncated, corrupt, of another format version or
+// for a source of another hash.
+bool deserialize_ast(std::string_view bytes, std::uint64_t hash,
+                     FlatAst &ast);
+
+struct AstCacheStats {
+  size_t hits;
+  size_t misses;
+  // Entries which couldn't be written, the cache carries on without them
+  size_t write_failures;
+};
+
+// Parsed trees kept in a directory across runs, one file per source named
+// after its hash. Several processes may share the directory, entries are
+// written to a temporary file and renamed into place.
+class AstCache {
+public:
+  explicit AstCache(std::filesystem::path directory);
+
+  // Fills ast with the tree of source, from the cache on a hit. On a miss
+  // source is scanned and parsed and the tree stored for the next time.
+  NodeIndex load(std::string_view source, FlatAst &ast);
+  std::filesystem::path entry_path(std::uint64_t hash) const;
+  AstCacheStats stats() const noexcept { return m_stats; }
+
+private:
+  void store(std::uint64_t hash, const FlatAst &ast);
+
+  std::filesystem::path m_directory;
+  Scanner m_scanner;
+  Parser m_parser;
+  AstCacheStats m_stats{};
+};
@@ -0,0 +1,54 @@
+#include "batch_eval.hpp"
+#include "interpreter.hpp"
+#include <algorithm>
+#include <future>
+
+namespace {
+// Several chunks per worker so stealing can even out chunks of uneven cost
+constexpr size_t chunks_per_worker = 8;
+
+// Calls evaluate(i) for every i below count, in chunks spread over pool
+template <typename Evaluate>
+std::vector<Value> evaluate_chunked(ThreadPool &pool, size_t count,
+                                    Evaluate evaluate) {
+  std::vector<Value> results(count);
+  if (count == 0)
+    return results;
+  auto chunks = std::min(count, pool.size() * chunks_per_worker);
+  auto chunk_size = (count + chunks - 1) / chunks;
+  std::vector<std::future<void>> done;
+  done.reserve(chunks);
+  for (size_t begin = 0; begin < count; begin += chunk_size) {
+    auto end = std::min(count, begin + chunk_size);
+    // Each chunk writes its own slots only
+    done.push_back(pool.submit([&results, &evaluate, begin, end] {
+      for (auto i = begin; i < end; ++i)
+        results[i] = evaluate(i);
+    }));
+  }
+  for (auto &chunk : done)
+    chunk.get();
+  return results;
+}
+} // namespace
+
+std::vector<Value> evaluate_batch(ThreadPool &pool,
+                                  std::span<const Expr> exprs) {
+  return evaluate_chunked(pool, exprs.size(), [exprs](size_t i) {
+    return std::visit(Interpreter(), exprs[i]);
+  });
+}
+
+std::vector<Value> evaluate_batch(ThreadPool &pool, const FlatAst &ast,
+                                  std::span<const NodeIndex> roots) {
+  return evaluate_chunked(pool, roots.size(), [&ast, roots](size_t i) {
+    return Interpreter()(ast, roots[i]);
+  });
+}
+
+std::vector<Value> evaluate_batch(ThreadPool &pool, const Expr &expr,
+                                  size_t count) {
+  return evaluate_chunked(pool, count, [&expr](size_t) {
+    return std::visit(Interpreter(), expr);
+  });
+}
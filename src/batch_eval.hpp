@@ -0,0 +1,21 @@
+#pragma once
+#include "flat_ast.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include "value.hpp"
+#include <span>
+#include <vector>
+
+// Evaluation of many expressions on a ThreadPool. Interpreter keeps no
+// state, so the trees are only read and shared by every worker as they are.
+// Results come back in the order of the expressions. None of these may be
+// called from a job of pool, they block until the batch is done.
+
+std::vector<Value> evaluate_batch(ThreadPool &pool,
+                                  std::span<const Expr> exprs);
+// Trees of one arena, say each parsed into it by Parser::parse
+std::vector<Value> evaluate_batch(ThreadPool &pool, const FlatAst &ast,
+                                  std::span<const NodeIndex> roots);
+// Evaluates expr count times, with count results
+std::vector<Value> evaluate_batch(ThreadPool &pool, const Expr &expr,
+                                  size_t count);
@@ -0,0 +1,112 @@
+#include "bytecode.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+void Chunk::write_constant(Value value) {
+  auto index = constants.size();
+  constants.push_back(value);
+  if (index <= UINT8_MAX) {
+    write(OpCode::Constant);
+    code.push_back(static_cast<std::uint8_t>(index));
+    return;
+  }
+  // TODO better error handling
+  if (index > 0xFFFFFF)
+    abort();
+  write(OpCode::ConstantLong);
+  code.push_back(static_cast<std::uint8_t>(index & 0xFF));
+  code.push_back(static_cast<std::uint8_t>((index >> 8) & 0xFF));
+  code.push_back(static_cast<std::uint8_t>((index >> 16) & 0xFF));
+}
+
+Chunk Compiler::compile(const Expr &expr) {
+  m_chunk = Chunk{};
+  m_stack_depth = 0;
+  std::visit(*this, expr);
+  m_chunk.write(OpCode::Return);
+  return std::move(m_chunk);
+}
+
+void Compiler::emit(OpCode op, int stack_effect) {
+  m_chunk.write(op);
+  if (stack_effect < 0)
+    m_stack_depth -= static_cast<size_t>(-stack_effect);
+  else
+    m_stack_depth += static_cast<size_t>(stack_effect);
+  m_chunk.max_stack_depth = std::max(m_chunk.max_stack_depth, m_stack_depth);
+}
+
+void Compiler::operator()(const LiteralPtr &l) {
+  // Parser yields an empty literal for EoF
+  // TODO better error handling
+  if (!l)
+    abort();
+  if (l->is_bool()) {
+    emit(l->as_bool() ? OpCode::True : OpCode::False, 1);
+    return;
+  }
+  if (l->is_nil()) {
+    emit(OpCode::Nil, 1);
+    return;
+  }
+  m_chunk.write_constant(*l);
+  ++m_stack_depth;
+  m_chunk.max_stack_depth = std::max(m_chunk.max_stack_depth, m_stack_depth);
+}
+
+void Compiler::operator()(const UnaryExprPtr &expr) {
+  std::visit(*this, expr->expr);
+  using enum TokenType;
+  switch (expr->opr) {
+  case Bang:
+    emit(OpCode::Not, 0);
+    return;
+  case Minus:
+    emit(OpCode::Negate, 0);
+    return;
+  default:
+    // TODO better error handling
+    abort();
+  }
+}
+
+void Compiler::operator()(const BinaryExprPtr &expr) {
+  std::visit(*this, expr->lexpr);
+  std::visit(*this, expr->rexpr);
+  using enum TokenType;
+  switch (expr->opr) {
+  case Plus:
+    emit(OpCode::Add, -1);
+    return;
+  case Minus:
+    emit(OpCode::Subtract, -1);
+    return;
+  case Star:
+    emit(OpCode::Multiply, -1);
+    return;
+  case Slash:
+    emit(OpCode::Divide, -1);
+    return;
+  case Equal:
+    emit(OpCode::Equal, -1);
+    return;
+  case BangEqual:
+    emit(OpCode::NotEqual, -1);
+    return;
+  case Greater:
+    emit(OpCode::Greater, -1);
+    return;
+  case GreaterEqual:
+    emit(OpCode::GreaterEqual, -1);
+    return;
+  case Less:
+    emit(OpCode::Less, -1);
+    return;
+  case LessEqual:
+    emit(OpCode::LessEqual, -1);
+    return;
+  default:
+    // TODO better error handling
+    abort();
+  }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "parser.hpp"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+enum class OpCode : std::uint8_t {
+  Constant,     // 1 byte operand, index into the constant pool
+  ConstantLong, // 3 byte little endian operand, for pools over 256 entries
+  True,
+  False,
+  Nil,
+  Negate,
+  Not,
+  Add,
+  Subtract,
+  Multiply,
+  Divide,
+  Equal,
+  NotEqual,
+  Greater,
+  GreaterEqual,
+  Less,
+  LessEqual,
+  Return
+};
+
+// A compiled expression, code is executed from the first byte till Return.
+struct Chunk {
+  std::vector<std::uint8_t> code;
+  std::vector<Value> constants;
+  // Deepest the value stack gets while running code, lets the VM size its
+  // stack once per chunk
+  size_t max_stack_depth = 0;
+
+  void write(OpCode op) { code.push_back(std::to_underlying(op)); }
+  void write_constant(Value value);
+};
+
+// Lowers an Expr tree into a Chunk, operands are emitted before their
+// operator so the VM only ever works on the top of its stack.
+class Compiler {
+public:
+  Chunk compile(const Expr &expr);
+
+  void operator()(const LiteralPtr &l);
+  void operator()(const UnaryExprPtr &expr);
+  void operator()(const BinaryExprPtr &expr);
+
+private:
+  void emit(OpCode op, int stack_effect);
+
+  Chunk m_chunk;
+  size_t m_stack_depth = 0;
+};
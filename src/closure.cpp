@@ -0,0 +1,152 @@
+#include "closure.hpp"
+#include <cassert>
+#include <cstdlib>
+
+using enum TokenType;
+
+namespace {
+// TODO better error handling
+inline void require_numbers(Value left, Value right) noexcept {
+  if (!left.is_number() || !right.is_number())
+    abort();
+}
+
+// Same semantics as Interpreter::perform_binary_op, decided at compile time
+template <TokenType Opr> Value apply(Value left, Value right) noexcept {
+  if constexpr (Opr == Plus || Opr == Minus || Opr == Star || Opr == Slash) {
+    require_numbers(left, right);
+    if constexpr (Opr == Plus)
+      return add_numbers(left, right);
+    else if constexpr (Opr == Minus)
+      return subtract_numbers(left, right);
+    else if constexpr (Opr == Star)
+      return multiply_numbers(left, right);
+    else
+      return divide_numbers(left, right);
+  } else if constexpr (Opr == Equal) {
+    return left == right;
+  } else if constexpr (Opr == BangEqual) {
+    return left != right;
+  } else {
+    assert(left.is_number() || left.is_string());
+    assert(right.is_number() || right.is_string());
+    if constexpr (Opr == Greater)
+      return left > right;
+    else if constexpr (Opr == GreaterEqual)
+      return left >= right;
+    else if constexpr (Opr == Less)
+      return left < right;
+    else
+      return left <= right;
+  }
+}
+
+Value literal(const ClosureNode &node) noexcept { return node.value; }
+
+Value negate(const ClosureNode &node) noexcept {
+  auto operand = node.lhs->fn(*node.lhs);
+  // TODO better error handling
+  if (!operand.is_number())
+    abort();
+  return negate_number(operand);
+}
+
+Value logical_not(const ClosureNode &node) noexcept {
+  auto operand = node.lhs->fn(*node.lhs);
+  // TODO better error handling
+  if (!operand.is_bool())
+    abort();
+  return !operand.as_bool();
+}
+
+template <TokenType Opr> Value binary(const ClosureNode &node) noexcept {
+  auto left = node.lhs->fn(*node.lhs);
+  return apply<Opr>(left, node.rhs->fn(*node.rhs));
+}
+
+// Right operand is a literal, kept in the node rather than called for
+template <TokenType Opr> Value binary_literal(const ClosureNode &node) noexcept {
+  return apply<Opr>(node.lhs->fn(*node.lhs), node.value);
+}
+
+template <TokenType Opr> struct Binary {
+  static constexpr ClosureNode::Fn fn = binary<Opr>;
+  static constexpr ClosureNode::Fn literal_fn = binary_literal<Opr>;
+};
+
+// The one place an operator is switched on, when compiling
+ClosureNode::Fn binary_fn(TokenType opr, bool literal_rhs) noexcept {
+#define JLOX_BINARY_CASE(opr)                                                  \
+  case opr:                                                                    \
+    return literal_rhs ? Binary<opr>::literal_fn : Binary<opr>::fn;
+  switch (opr) {
+    JLOX_BINARY_CASE(Plus)
+    JLOX_BINARY_CASE(Minus)
+    JLOX_BINARY_CASE(Star)
+    JLOX_BINARY_CASE(Slash)
+    JLOX_BINARY_CASE(Equal)
+    JLOX_BINARY_CASE(BangEqual)
+    JLOX_BINARY_CASE(Greater)
+    JLOX_BINARY_CASE(GreaterEqual)
+    JLOX_BINARY_CASE(Less)
+    JLOX_BINARY_CASE(LessEqual)
+  default:
+    // TODO better error handling
+    abort();
+  }
+#undef JLOX_BINARY_CASE
+}
+
+// Nodes in expr, so they can be reserved before pointing at each other
+struct NodeCounter {
+  size_t operator()(const LiteralPtr &) const noexcept { return 1; }
+  size_t operator()(const UnaryExprPtr &expr) const noexcept {
+    return 1 + std::visit(*this, expr->expr);
+  }
+  size_t operator()(const BinaryExprPtr &expr) const noexcept {
+    return 1 + std::visit(*this, expr->lexpr) + std::visit(*this, expr->rexpr);
+  }
+};
+} // namespace
+
+CompiledExpr ClosureCompiler::compile(const Expr &expr) {
+  m_compiled = CompiledExpr{};
+  m_compiled.m_nodes.reserve(std::visit(NodeCounter(), expr));
+  m_compiled.m_root = std::visit(*this, expr);
+  return std::move(m_compiled);
+}
+
+const ClosureNode *ClosureCompiler::add(ClosureNode node) {
+  // Never reallocates, compile reserved every node
+  assert(m_compiled.m_nodes.size() < m_compiled.m_nodes.capacity());
+  return &m_compiled.m_nodes.emplace_back(node);
+}
+
+const ClosureNode *ClosureCompiler::operator()(const LiteralPtr &l) {
+  // Parser yields an empty literal for EoF
+  // TODO better error handling
+  if (!l)
+    abort();
+  return add({literal, nullptr, nullptr, *l});
+}
+
+const ClosureNode *ClosureCompiler::operator()(const UnaryExprPtr &expr) {
+  auto operand = std::visit(*this, expr->expr);
+  switch (expr->opr) {
+  case Bang:
+    return add({logical_not, operand, nullptr, {}});
+  case Minus:
+    return add({negate, operand, nullptr, {}});
+  default:
+    // TODO better error handling
+    abort();
+  }
+}
+
+const ClosureNode *ClosureCompiler::operator()(const BinaryExprPtr &expr) {
+  auto left = std::visit(*this, expr->lexpr);
+  auto right = std::visit(*this, expr->rexpr);
+  if (right->fn == literal)
+    return add({binary_fn(expr->opr, true), left, nullptr, right->value});
+  return add({binary_fn(expr->opr, false), left, right, {}});
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "parser.hpp"
+#include "value.hpp"
+#include <vector>
+
+// Node of a compiled expression. fn is the code for exactly this node's
+// kind and operator, chosen when compiling, so running it calls straight
+// into its operands without looking at a variant or an operator again.
+struct ClosureNode {
+  using Fn = Value (*)(const ClosureNode &node) noexcept;
+  Fn fn;
+  const ClosureNode *lhs = nullptr;
+  const ClosureNode *rhs = nullptr;
+  // Literal, or the right operand when rhs was a literal folded into fn
+  Value value;
+};
+
+// Expression compiled by ClosureCompiler. Gives the same results as
+// Interpreter, sitting between its tree walk and the VM.
+class CompiledExpr {
+public:
+  Value operator()() const noexcept { return m_root->fn(*m_root); }
+  size_t size() const noexcept { return m_nodes.size(); }
+
+private:
+  friend class ClosureCompiler;
+  // Reserved up front, nodes point at each other
+  std::vector<ClosureNode> m_nodes;
+  const ClosureNode *m_root = nullptr;
+};
+
+class ClosureCompiler {
+public:
+  CompiledExpr compile(const Expr &expr);
+
+  const ClosureNode *operator()(const LiteralPtr &l);
+  const ClosureNode *operator()(const UnaryExprPtr &expr);
+  const ClosureNode *operator()(const BinaryExprPtr &expr);
+
+private:
+  const ClosureNode *add(ClosureNode node);
+
+  CompiledExpr m_compiled;
+};
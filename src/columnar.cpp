@@ -0,0 +1,426 @@
+#include "columnar.hpp"
+#include "interpreter.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using enum TokenType;
+
+namespace {
+constexpr size_t block_words = columnar_block_rows / 64;
+
+// Bits of the last mask word which hold rows
+inline std::uint64_t tail_bits(size_t rows) noexcept {
+  return rows % 64 == 0 ? ~std::uint64_t{0}
+                        : (std::uint64_t{1} << (rows % 64)) - 1;
+}
+inline size_t words(size_t rows) noexcept { return (rows + 63) / 64; }
+
+inline double at(const double *values, size_t i) noexcept { return values[i]; }
+inline double at(double scalar, size_t) noexcept { return scalar; }
+
+template <TokenType Opr> inline double arithmetic(double l, double r) noexcept {
+  if constexpr (Opr == Plus)
+    return l + r;
+  else if constexpr (Opr == Minus)
+    return l - r;
+  else if constexpr (Opr == Star)
+    return l * r;
+  else
+    return l / r;
+}
+
+template <TokenType Opr> inline bool compare(double l, double r) noexcept {
+  if constexpr (Opr == Less)
+    return l < r;
+  else if constexpr (Opr == LessEqual)
+    return l <= r;
+  else if constexpr (Opr == Greater)
+    return l > r;
+  else if constexpr (Opr == GreaterEqual)
+    return l >= r;
+  else if constexpr (Opr == Equal)
+    return l == r;
+  else
+    return l != r;
+}
+
+// Plain loops over restrict pointers, which the compiler turns into vector
+// code for whatever the target is
+template <TokenType Opr, typename Left, typename Right>
+void numbers_kernel(Left left, Right right, double *__restrict out,
+                    size_t rows) noexcept {
+  for (size_t i = 0; i < rows; ++i)
+    out[i] = arithmetic<Opr>(at(left, i), at(right, i));
+}
+
+#if defined(__x86_64__)
+// SSE2 is part of x86-64, no target attribute needed. The predicates are
+// the ordered ones except for !=, so NaN compares as it does on doubles.
+template <TokenType Opr> inline __m128d compare(__m128d l, __m128d r) noexcept {
+  if constexpr (Opr == Less)
+    return _mm_cmplt_pd(l, r);
+  else if constexpr (Opr == LessEqual)
+    return _mm_cmple_pd(l, r);
+  else if constexpr (Opr == Greater)
+    return _mm_cmpgt_pd(l, r);
+  else if constexpr (Opr == GreaterEqual)
+    return _mm_cmpge_pd(l, r);
+  else if constexpr (Opr == Equal)
+    return _mm_cmpeq_pd(l, r);
+  else
+    return _mm_cmpneq_pd(l, r);
+}
+
+inline __m128d load2(const double *values, size_t i) noexcept {
+  return _mm_loadu_pd(values + i);
+}
+inline __m128d load2(__m128d scalar, size_t) noexcept { return scalar; }
+#endif
+
+// Two rows per compare, their movemask bits packed straight into the mask
+template <TokenType Opr, typename Right>
+void compare_kernel(const double *left, Right right, std::uint64_t *out,
+                    size_t rows) noexcept {
+  size_t i = 0;
+#if defined(__x86_64__)
+  auto wide = [&] {
+    if constexpr (std::is_same_v<Right, double>)
+      return _mm_set1_pd(right);
+    else
+      return right;
+  }();
+  for (; i + 64 <= rows; i += 64) {
+    std::uint64_t bits = 0;
+    for (size_t j = 0; j < 64; j += 2) {
+      auto lanes = compare<Opr>(load2(left, i + j), load2(wide, i + j));
+      bits |= static_cast<std::uint64_t>(_mm_movemask_pd(lanes)) << j;
+    }
+    out[i / 64] = bits;
+  }
+#endif
+  for (; i < rows; i += 64) {
+    std::uint64_t bits = 0;
+    for (size_t j = 0; j < 64 && i + j < rows; ++j)
+      bits |= static_cast<std::uint64_t>(
+                  compare<Opr>(left[i + j], at(right, i + j)))
+              << j;
+    out[i / 64] = bits;
+  }
+}
+
+// Calls f with opr as a compile time constant
+template <typename F> void with_operator(TokenType opr, F &&f) {
+#define JLOX_OPERATOR_CASE(opr)                                                \
+  case opr:                                                                    \
+    return f(std::integral_constant<TokenType, opr>{});
+  switch (opr) {
+    JLOX_OPERATOR_CASE(Plus)
+    JLOX_OPERATOR_CASE(Minus)
+    JLOX_OPERATOR_CASE(Star)
+    JLOX_OPERATOR_CASE(Slash)
+    JLOX_OPERATOR_CASE(Equal)
+    JLOX_OPERATOR_CASE(BangEqual)
+    JLOX_OPERATOR_CASE(Greater)
+    JLOX_OPERATOR_CASE(GreaterEqual)
+    JLOX_OPERATOR_CASE(Less)
+    JLOX_OPERATOR_CASE(LessEqual)
+  default:
+    // TODO better error handling
+    abort();
+  }
+#undef JLOX_OPERATOR_CASE
+}
+
+// Comparison giving the same answer with the operands swapped
+TokenType swapped(TokenType opr) noexcept {
+  switch (opr) {
+  case Less:
+    return Greater;
+  case LessEqual:
+    return GreaterEqual;
+  case Greater:
+    return Less;
+  case GreaterEqual:
+    return LessEqual;
+  default:
+    return opr;
+  }
+}
+
+bool is_numbers(const ColumnarCompiler::Operand &operand) noexcept {
+  using enum ColumnarCompiler::Operand::Kind;
+  return operand.kind == Numbers ||
+         (operand.kind == Constant && operand.value.is_number());
+}
+} // namespace
+
+ColumnarResult ColumnarExpr::operator()(
+    std::span<const std::span<const double>> columns) const {
+  JLOX_TRACE_SCOPE("Columnar");
+  // TODO better error handling
+  if (columns.size() != m_columns)
+    abort();
+  size_t rows = columns.empty() ? 0 : columns.front().size();
+  for (auto column : columns)
+    if (column.size() != rows)
+      abort();
+
+  ColumnarResult result{m_kind, rows, {}, {}};
+  if (m_kind == ColumnarResult::Kind::Numbers)
+    result.numbers.resize(rows);
+  else
+    result.mask.resize(words(rows));
+  if (m_constant) {
+    if (m_kind == ColumnarResult::Kind::Numbers)
+      std::ranges::fill(result.numbers, m_value.as_number());
+    else if (m_value.as_bool() && rows) {
+      std::ranges::fill(result.mask, ~std::uint64_t{0});
+      result.mask.back() = tail_bits(rows);
+    }
+    return result;
+  }
+
+  // Registers for one block, allocated once for the whole run
+  std::vector<double> numbers(m_number_registers * columnar_block_rows);
+  std::vector<std::uint64_t> masks(m_mask_registers * block_words);
+  std::vector<const double *> inputs(m_columns + m_number_registers);
+  for (size_t i = 0; i < m_number_registers; ++i)
+    inputs[m_columns + i] = numbers.data() + i * columnar_block_rows;
+  auto output = [&](std::uint16_t index) {
+    return numbers.data() + (index - m_columns) * columnar_block_rows;
+  };
+  auto mask = [&](std::uint16_t index) {
+    return masks.data() + index * block_words;
+  };
+
+  for (size_t begin = 0; begin < rows; begin += columnar_block_rows) {
+    auto count = std::min(columnar_block_rows, rows - begin);
+    for (size_t i = 0; i < m_columns; ++i)
+      inputs[i] = columns[i].data() + begin;
+
+    for (const auto &op : m_ops) {
+      using enum ColumnarOp::Code;
+      switch (op.code) {
+      case NumbersVV:
+        with_operator(op.opr, [&](auto opr) {
+          numbers_kernel<decltype(opr)::value>(inputs[op.lhs], inputs[op.rhs],
+                                               output(op.dst), count);
+        });
+        break;
+      case NumbersVS:
+        with_operator(op.opr, [&](auto opr) {
+          numbers_kernel<decltype(opr)::value>(inputs[op.lhs], op.scalar,
+                                               output(op.dst), count);
+        });
+        break;
+      case NumbersSV:
+        with_operator(op.opr, [&](auto opr) {
+          numbers_kernel<decltype(opr)::value>(op.scalar, inputs[op.rhs],
+                                               output(op.dst), count);
+        });
+        break;
+      case Negate:
+        numbers_kernel<Star>(-1.0, inputs[op.lhs], output(op.dst), count);
+        break;
+      case CompareVV:
+        with_operator(op.opr, [&](auto opr) {
+          compare_kernel<decltype(opr)::value>(inputs[op.lhs], inputs[op.rhs],
+                                               mask(op.dst), count);
+        });
+        break;
+      case CompareVS:
+        with_operator(op.opr, [&](auto opr) {
+          compare_kernel<decltype(opr)::value>(inputs[op.lhs], op.scalar,
+                                               mask(op.dst), count);
+        });
+        break;
+      case Not:
+        for (size_t i = 0; i < words(count); ++i)
+          mask(op.dst)[i] = ~mask(op.lhs)[i];
+        mask(op.dst)[words(count) - 1] &= tail_bits(count);
+        break;
+      case MaskEqual:
+        for (size_t i = 0; i < words(count); ++i)
+          mask(op.dst)[i] = ~(mask(op.lhs)[i] ^ mask(op.rhs)[i]);
+        mask(op.dst)[words(count) - 1] &= tail_bits(count);
+        break;
+      case MaskNotEqual:
+        for (size_t i = 0; i < words(count); ++i)
+          mask(op.dst)[i] = mask(op.lhs)[i] ^ mask(op.rhs)[i];
+        break;
+      }
+    }
+
+    if (m_kind == ColumnarResult::Kind::Numbers)
+      std::copy_n(inputs[m_result], count, result.numbers.data() + begin);
+    else
+      std::copy_n(mask(m_result), words(count),
+                  result.mask.data() + begin / 64);
+  }
+  return result;
+}
+
+ColumnarExpr
+ColumnarCompiler::compile(const Expr &expr,
+                          std::span<const std::string_view> columns) {
+  m_names = columns;
+  m_compiled = ColumnarExpr{};
+  m_compiled.m_columns = columns.size();
+  auto root = std::visit(*this, expr);
+  switch (root.kind) {
+  case Operand::Kind::Constant:
+    // TODO better error handling
+    if (!root.value.is_number() && !root.value.is_bool())
+      abort();
+    m_compiled.m_kind = root.value.is_number() ? ColumnarResult::Kind::Numbers
+                                               : ColumnarResult::Kind::Mask;
+    m_compiled.m_constant = true;
+    m_compiled.m_value = root.value;
+    break;
+  case Operand::Kind::Numbers:
+    m_compiled.m_kind = ColumnarResult::Kind::Numbers;
+    break;
+  case Operand::Kind::Mask:
+    m_compiled.m_kind = ColumnarResult::Kind::Mask;
+    break;
+  }
+  m_compiled.m_result = root.index;
+  return std::move(m_compiled);
+}
+
+ColumnarCompiler::Operand ColumnarCompiler::numbers(ColumnarOp op) {
+  op.dst = static_cast<std::uint16_t>(m_compiled.m_columns +
+                                      m_compiled.m_number_registers++);
+  m_compiled.m_ops.push_back(op);
+  return {Operand::Kind::Numbers, op.dst, {}};
+}
+
+ColumnarCompiler::Operand ColumnarCompiler::mask(ColumnarOp op) {
+  op.dst = m_compiled.m_mask_registers++;
+  m_compiled.m_ops.push_back(op);
+  return {Operand::Kind::Mask, op.dst, {}};
+}
+
+ColumnarCompiler::Operand ColumnarCompiler::operator()(const LiteralPtr &l) {
+  // Parser yields an empty literal for EoF
+  // TODO better error handling
+  if (!l)
+    abort();
+  if (l->is_string()) {
+    auto name = std::ranges::find(m_names, l->as_string());
+    if (name != m_names.end())
+      return {Operand::Kind::Numbers,
+              static_cast<std::uint16_t>(name - m_names.begin()),
+              {}};
+  }
+  return {Operand::Kind::Constant, 0, *l};
+}
+
+ColumnarCompiler::Operand
+ColumnarCompiler::operator()(const UnaryExprPtr &expr) {
+  auto operand = std::visit(*this, expr->expr);
+  using enum ColumnarOp::Code;
+  switch (operand.kind) {
+  case Operand::Kind::Constant:
+    return {Operand::Kind::Constant, 0,
+            Interpreter().perform_unary_op(operand.value, expr->opr)};
+  case Operand::Kind::Numbers:
+    // TODO better error handling
+    if (expr->opr != Minus)
+      abort();
+    return numbers({Negate, expr->opr, 0, operand.index, 0, 0});
+  case Operand::Kind::Mask:
+    // TODO better error handling
+    if (expr->opr != Bang)
+      abort();
+    return mask({Not, expr->opr, 0, operand.index, 0, 0});
+  }
+  // TODO better error handling
+  abort();
+}
+
+ColumnarCompiler::Operand
+ColumnarCompiler::operator()(const BinaryExprPtr &expr) {
+  auto left = std::visit(*this, expr->lexpr);
+  auto right = std::visit(*this, expr->rexpr);
+  if (left.kind == Operand::Kind::Constant &&
+      right.kind == Operand::Kind::Constant)
+    return {Operand::Kind::Constant, 0,
+            Interpreter().perform_binary_op(left.value, expr->opr,
+                                            right.value)};
+  switch (expr->opr) {
+  case Plus:
+  case Minus:
+  case Star:
+  case Slash:
+    return arithmetic(expr->opr, left, right);
+  case Greater:
+  case GreaterEqual:
+  case Less:
+  case LessEqual:
+    return compare(expr->opr, left, right);
+  case Equal:
+    return equality(true, left, right);
+  case BangEqual:
+    return equality(false, left, right);
+  }
+  // TODO better error handling
+  abort();
+}
+
+ColumnarCompiler::Operand
+ColumnarCompiler::arithmetic(TokenType opr, Operand left, Operand right) {
+  // TODO better error handling
+  if (!is_numbers(left) || !is_numbers(right))
+    abort();
+  using enum ColumnarOp::Code;
+  if (left.kind == Operand::Kind::Constant)
+    return numbers(
+        {NumbersSV, opr, 0, 0, right.index, left.value.as_number()});
+  if (right.kind == Operand::Kind::Constant)
+    return numbers(
+        {NumbersVS, opr, 0, left.index, 0, right.value.as_number()});
+  return numbers({NumbersVV, opr, 0, left.index, right.index, 0});
+}
+
+ColumnarCompiler::Operand
+ColumnarCompiler::compare(TokenType opr, Operand left, Operand right) {
+  // Columns are numbers, which only compare with numbers
+  // TODO better error handling
+  if (!is_numbers(left) || !is_numbers(right))
+    abort();
+  using enum ColumnarOp::Code;
+  if (left.kind == Operand::Kind::Constant)
+    return mask({CompareVS, swapped(opr), 0, right.index, 0,
+                 left.value.as_number()});
+  if (right.kind == Operand::Kind::Constant)
+    return mask(
+        {CompareVS, opr, 0, left.index, 0, right.value.as_number()});
+  return mask({CompareVV, opr, 0, left.index, right.index, 0});
+}
+
+ColumnarCompiler::Operand
+ColumnarCompiler::equality(bool equal, Operand left, Operand right) {
+  using enum ColumnarOp::Code;
+  auto opr = equal ? Equal : BangEqual;
+  if (is_numbers(left) && is_numbers(right))
+    return compare(opr, left, right);
+  if (left.kind == Operand::Kind::Mask && right.kind == Operand::Kind::Mask)
+    return mask({equal ? MaskEqual : MaskNotEqual, opr, 0, left.index,
+                 right.index, 0});
+  if (left.kind == Operand::Kind::Constant)
+    std::swap(left, right);
+  // mask == true is the mask itself, mask == false its inverse
+  if (left.kind == Operand::Kind::Mask && right.value.is_bool())
+    return right.value.as_bool() == equal
+               ? left
+               : mask({Not, Bang, 0, left.index, 0, 0});
+  // Values of different types are never equal
+  return {Operand::Kind::Constant, 0, !equal};
+}
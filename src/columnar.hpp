@@ -0,0 +1,108 @@
+#pragma once
+#include "parser.hpp"
+#include "value.hpp"
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Rows go through a ColumnarExpr this many at a time, every node of the
+// expression being one pass over the block
+inline constexpr size_t columnar_block_rows = 1024;
+
+// One entry per row, numbers when the expression computes numbers and a
+// bit per row when it computes booleans
+struct ColumnarResult {
+  enum class Kind : std::uint8_t { Numbers, Mask };
+  Kind kind = Kind::Numbers;
+  size_t rows = 0;
+  std::vector<double> numbers;
+  // Row i is bit i % 64 of word i / 64, bits past the last row are 0
+  std::vector<std::uint64_t> mask;
+
+  bool test(size_t row) const noexcept {
+    return (mask[row / 64] >> (row % 64)) & 1;
+  }
+  // What Interpreter gives for the row
+  Value value(size_t row) const noexcept {
+    if (kind == Kind::Mask)
+      return test(row);
+    return Value::number(numbers[row]);
+  }
+};
+
+// Instruction of a ColumnarExpr. Numbers operands index the columns
+// followed by the number registers, masks index the mask registers.
+struct ColumnarOp {
+  enum class Code : std::uint8_t {
+    // Arithmetic of opr, S being the scalar
+    NumbersVV,
+    NumbersVS,
+    NumbersSV,
+    Negate,
+    // Comparison of opr into a mask
+    CompareVV,
+    CompareVS,
+    Not,
+    MaskEqual,
+    MaskNotEqual,
+  };
+  Code code;
+  TokenType opr;
+  std::uint16_t dst;
+  std::uint16_t lhs;
+  std::uint16_t rhs;
+  double scalar;
+};
+
+// Expression compiled by ColumnarCompiler to run over whole columns, for
+// using one expression as a formula or predicate over many rows. Gives the
+// same results as running Interpreter once per row.
+class ColumnarExpr {
+public:
+  // columns in the order of the names given to compile, all the same size
+  ColumnarResult
+  operator()(std::span<const std::span<const double>> columns) const;
+  size_t size() const noexcept { return m_ops.size(); }
+
+private:
+  friend class ColumnarCompiler;
+  std::vector<ColumnarOp> m_ops;
+  size_t m_columns = 0;
+  std::uint16_t m_number_registers = 0;
+  std::uint16_t m_mask_registers = 0;
+  // Where the result ends up, a constant when no column reached the root
+  ColumnarResult::Kind m_kind = ColumnarResult::Kind::Numbers;
+  bool m_constant = false;
+  Value m_value;
+  std::uint16_t m_result = 0;
+};
+
+// Lox expressions have no variables, a column is referred to by a string
+// literal holding its name, so with a column "price" the predicate is
+// written "price" * 2 > 100. Subtrees without columns are folded.
+class ColumnarCompiler {
+public:
+  ColumnarExpr compile(const Expr &expr,
+                       std::span<const std::string_view> columns);
+
+  struct Operand {
+    enum class Kind : std::uint8_t { Constant, Numbers, Mask };
+    Kind kind;
+    std::uint16_t index = 0;
+    Value value;
+  };
+  Operand operator()(const LiteralPtr &l);
+  Operand operator()(const UnaryExprPtr &expr);
+  Operand operator()(const BinaryExprPtr &expr);
+
+private:
+  Operand numbers(ColumnarOp op);
+  Operand mask(ColumnarOp op);
+  Operand arithmetic(TokenType opr, Operand left, Operand right);
+  Operand compare(TokenType opr, Operand left, Operand right);
+  Operand equality(bool equal, Operand left, Operand right);
+
+  std::span<const std::string_view> m_names;
+  ColumnarExpr m_compiled;
+};
@@ -0,0 +1,277 @@
+#include "dfa_lexer.hpp"
+#include "keywords.hpp"
+#include <array>
+
+namespace {
+enum CharClass : std::uint8_t {
+  Other,
+  Newline,
+  Blank,
+  Digit,
+  Alpha,
+  Quote,
+  Slash,
+  Star,
+  Bang,
+  EqualSign,
+  LessSign,
+  GreaterSign,
+  Dot,
+  OpenParen,
+  CloseParen,
+  OpenBrace,
+  CloseBrace,
+  CommaSign,
+  MinusSign,
+  PlusSign,
+  SemicolonSign,
+  End, // Past the last byte, never in char_classes
+  class_count
+};
+
+// States a token can be in the middle of
+enum State : std::uint8_t {
+  Start,
+  AfterBang,
+  AfterEqual,
+  AfterLess,
+  AfterGreater,
+  AfterSlash,
+  InWhitespace,
+  InLineComment,
+  InBlockComment,
+  InBlockCommentStar,
+  InString,
+  InNumber,
+  InNumberDot,
+  InFraction,
+  InIdentifier,
+  state_count
+};
+
+enum class ActionKind : std::uint8_t { Emit, Skip, Fail };
+
+// What to do once the automaton stops. backtrack counts the bytes read past
+// the end of the token, 1 when the last byte only ended it. trim drops the
+// quotes off strings.
+struct Action {
+  ActionKind kind;
+  TokenType type;
+  ScanError error;
+  std::uint8_t backtrack;
+  std::uint8_t trim;
+};
+
+constexpr Action emit(TokenType type, std::uint8_t backtrack = 0) {
+  return {ActionKind::Emit, type, ScanError{}, backtrack, 0};
+}
+
+// Accepting states follow the scanning states, each one has an Action
+constexpr std::array actions{
+    emit(TokenType::LeftParen),
+    emit(TokenType::RightParen),
+    emit(TokenType::LeftBrace),
+    emit(TokenType::RightBrace),
+    emit(TokenType::Comma),
+    emit(TokenType::Dot),
+    emit(TokenType::Minus),
+    emit(TokenType::Plus),
+    emit(TokenType::Semicolon),
+    emit(TokenType::Star),
+    emit(TokenType::BangEqual),
+    emit(TokenType::Equal),
+    emit(TokenType::LessEqual),
+    emit(TokenType::GreaterEqual),
+    emit(TokenType::Bang, 1),
+    emit(TokenType::Assignment, 1),
+    emit(TokenType::Less, 1),
+    emit(TokenType::Greater, 1),
+    emit(TokenType::Slash, 1),
+    emit(TokenType::Number, 1),
+    emit(TokenType::Identifier, 1),
+    emit(TokenType::EoF, 1),
+    Action{ActionKind::Emit, TokenType::String, ScanError{}, 0, 1},
+    // Whitespace and line comments end on a byte of the next token
+    Action{ActionKind::Skip, TokenType::EoF, ScanError{}, 1, 0},
+    // Block comments end on their own '/'
+    Action{ActionKind::Skip, TokenType::EoF, ScanError{}, 0, 0},
+    Action{ActionKind::Fail, TokenType::EoF, ScanError::NoScanableToken, 0, 0},
+    Action{ActionKind::Fail, TokenType::EoF, ScanError::NoString, 1, 0},
+    Action{ActionKind::Fail, TokenType::EoF, ScanError::NoMultiLineComment, 1,
+           0},
+    // "1." without a digit after the dot, which is left for the next token
+    emit(TokenType::Number, 2),
+};
+
+constexpr std::uint8_t accept(size_t action) {
+  return static_cast<std::uint8_t>(state_count + action);
+}
+// Indices into actions
+constexpr auto emit_bang = accept(14);
+constexpr auto emit_assignment = accept(15);
+constexpr auto emit_less = accept(16);
+constexpr auto emit_greater = accept(17);
+constexpr auto emit_slash = accept(18);
+constexpr auto emit_number = accept(19);
+constexpr auto emit_identifier = accept(20);
+constexpr auto emit_eof = accept(21);
+constexpr auto emit_string = accept(22);
+constexpr auto skip_backtrack = accept(23);
+constexpr auto skip = accept(24);
+constexpr auto fail_token = accept(25);
+constexpr auto fail_string = accept(26);
+constexpr auto fail_comment = accept(27);
+constexpr auto emit_number_before_dot = accept(28);
+static_assert(actions.size() + state_count <= 256);
+
+constexpr auto char_classes = [] {
+  std::array<CharClass, 256> table{};
+  auto set = [&table](char c, CharClass cls) {
+    table[static_cast<unsigned char>(c)] = cls;
+  };
+  for (char c = '0'; c <= '9'; ++c)
+    set(c, Digit);
+  for (char c = 'a'; c <= 'z'; ++c)
+    set(c, Alpha);
+  for (char c = 'A'; c <= 'Z'; ++c)
+    set(c, Alpha);
+  set('\n', Newline);
+  set(' ', Blank);
+  set('\t', Blank);
+  set('\r', Blank);
+  set('"', Quote);
+  set('/', Slash);
+  set('*', Star);
+  set('!', Bang);
+  set('=', EqualSign);
+  set('<', LessSign);
+  set('>', GreaterSign);
+  set('.', Dot);
+  set('(', OpenParen);
+  set(')', CloseParen);
+  set('{', OpenBrace);
+  set('}', CloseBrace);
+  set(',', CommaSign);
+  set('-', MinusSign);
+  set('+', PlusSign);
+  set(';', SemicolonSign);
+  return table;
+}();
+
+using TransitionTable =
+    std::array<std::array<std::uint8_t, class_count>, state_count>;
+
+constexpr auto transitions = [] {
+  TransitionTable table{};
+  auto all = [&table](State from, std::uint8_t to) { table[from].fill(to); };
+
+  auto &start = table[Start];
+  start.fill(fail_token);
+  start[Newline] = InWhitespace;
+  start[Blank] = InWhitespace;
+  start[Digit] = InNumber;
+  start[Alpha] = InIdentifier;
+  start[Quote] = InString;
+  start[Slash] = AfterSlash;
+  start[Bang] = AfterBang;
+  start[EqualSign] = AfterEqual;
+  start[LessSign] = AfterLess;
+  start[GreaterSign] = AfterGreater;
+  start[OpenParen] = accept(0);
+  start[CloseParen] = accept(1);
+  start[OpenBrace] = accept(2);
+  start[CloseBrace] = accept(3);
+  start[CommaSign] = accept(4);
+  start[Dot] = accept(5);
+  start[MinusSign] = accept(6);
+  start[PlusSign] = accept(7);
+  start[SemicolonSign] = accept(8);
+  start[Star] = accept(9);
+  start[End] = emit_eof;
+
+  all(AfterBang, emit_bang);
+  table[AfterBang][EqualSign] = accept(10);
+  all(AfterEqual, emit_assignment);
+  table[AfterEqual][EqualSign] = accept(11);
+  all(AfterLess, emit_less);
+  table[AfterLess][EqualSign] = accept(12);
+  all(AfterGreater, emit_greater);
+  table[AfterGreater][EqualSign] = accept(13);
+
+  all(AfterSlash, emit_slash);
+  table[AfterSlash][Slash] = InLineComment;
+  table[AfterSlash][Star] = InBlockComment;
+
+  all(InWhitespace, skip_backtrack);
+  table[InWhitespace][Newline] = InWhitespace;
+  table[InWhitespace][Blank] = InWhitespace;
+
+  // Newline is left for InWhitespace
+  all(InLineComment, InLineComment);
+  table[InLineComment][Newline] = skip_backtrack;
+  table[InLineComment][End] = skip_backtrack;
+
+  all(InBlockComment, InBlockComment);
+  table[InBlockComment][Star] = InBlockCommentStar;
+  table[InBlockComment][End] = fail_comment;
+  all(InBlockCommentStar, InBlockComment);
+  table[InBlockCommentStar][Star] = InBlockCommentStar;
+  table[InBlockCommentStar][Slash] = skip;
+  table[InBlockCommentStar][End] = fail_comment;
+
+  all(InString, InString);
+  table[InString][Quote] = emit_string;
+  table[InString][End] = fail_string;
+
+  all(InNumber, emit_number);
+  table[InNumber][Digit] = InNumber;
+  table[InNumber][Dot] = InNumberDot;
+  all(InNumberDot, emit_number_before_dot);
+  table[InNumberDot][Digit] = InFraction;
+  all(InFraction, emit_number);
+  table[InFraction][Digit] = InFraction;
+
+  all(InIdentifier, emit_identifier);
+  table[InIdentifier][Alpha] = InIdentifier;
+  return table;
+}();
+} // namespace
+
+DfaLexer::Result DfaLexer::next() noexcept {
+  while (true) {
+    const char *start = m_position;
+    std::uint8_t state = Start;
+    CharClass cls;
+    do {
+      // End is read once at most, every state leaves on it
+      cls = m_position != m_end
+                ? char_classes[static_cast<unsigned char>(*m_position)]
+                : End;
+      state = transitions[state][cls];
+      ++m_position;
+      m_line += cls == Newline;
+    } while (state < state_count);
+
+    const auto &action = actions[state - state_count];
+    m_position -= action.backtrack;
+    // Only the last byte read can be a newline
+    m_line -= static_cast<std::uint32_t>(action.backtrack != 0 &&
+                                         cls == Newline);
+    switch (action.kind) {
+    case ActionKind::Skip:
+      continue;
+    case ActionKind::Fail:
+      return std::unexpected(action.error);
+    case ActionKind::Emit:
+      break;
+    }
+
+    auto length = static_cast<std::uint32_t>(m_position - start);
+    auto type = action.type;
+    if (type == TokenType::Identifier)
+      type = identifier_type(std::string_view(start, length));
+    return CompactToken{
+        static_cast<std::uint32_t>(start - m_begin) + action.trim,
+        length - 2u * action.trim, m_line, type};
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "scanner.hpp"
+#include "token.hpp"
+#include <cstdint>
+#include <expected>
+#include <string_view>
+
+// Lexer driven by a character class table and a state transition table,
+// both built at compile time. Every byte costs two table loads and there
+// is no branching on what kind of token is being read, lookahead such as
+// "<=" or "/*" being ordinary transitions. Produces the same tokens and
+// errors as the switch based scanner.
+class DfaLexer {
+public:
+  using Result = std::expected<CompactToken, ScanError>;
+  explicit DfaLexer(std::string_view src) noexcept
+      : m_begin(src.data()), m_position(src.data()),
+        m_end(src.data() + src.size()) {}
+
+  // Returns EoF once the source is exhausted
+  Result next() noexcept;
+
+  // Restarts scanning at offset into the source, as if line lines had been
+  // seen before it
+  void seek(size_t offset, std::uint32_t line) noexcept {
+    m_position = m_begin + offset;
+    m_line = line;
+  }
+  size_t position() const noexcept {
+    return static_cast<size_t>(m_position - m_begin);
+  }
+  std::uint32_t line() const noexcept { return m_line; }
+
+private:
+  const char *m_begin;
+  const char *m_position;
+  const char *m_end;
+  std::uint32_t m_line = 1;
+};
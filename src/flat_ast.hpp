@@ -0,0 +1,120 @@
+#pragma once
+#include "parser.hpp"
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+enum class NodeIndex : std::uint32_t {};
+// Stands for the empty expression the parser produces at EoF
+inline constexpr NodeIndex invalid_node{UINT32_MAX};
+
+enum class NodeKind : std::uint8_t { Constant, Unary, Binary };
+
+// 16 byte node, children are indices into the owning FlatAst so a whole
+// tree lives in one contiguous table.
+struct FlatNode {
+  NodeKind kind;
+  TokenType opr;
+  // Constant: index into literal pool, Unary: operand, Binary: left operand
+  std::uint32_t lhs;
+  // Binary: right operand, unused otherwise
+  std::uint32_t rhs;
+};
+
+class FlatAst {
+public:
+  NodeIndex add_literal(Literal value) {
+    m_literals.push_back(value);
+    return add_node({NodeKind::Constant, TokenType::EoF,
+                     static_cast<std::uint32_t>(m_literals.size() - 1), 0});
+  }
+  NodeIndex add_unary(TokenType opr, NodeIndex expr) {
+    return add_node({NodeKind::Unary, opr, std::to_underlying(expr), 0});
+  }
+  NodeIndex add_binary(NodeIndex lexpr, TokenType opr, NodeIndex rexpr) {
+    return add_node({NodeKind::Binary, opr, std::to_underlying(lexpr),
+                     std::to_underlying(rexpr)});
+  }
+
+  const FlatNode &node(NodeIndex index) const noexcept {
+    return m_nodes[std::to_underlying(index)];
+  }
+  const Literal &literal(const FlatNode &node) const noexcept {
+    return m_literals[node.lhs];
+  }
+
+  NodeIndex root() const noexcept { return m_root; }
+  void set_root(NodeIndex root) noexcept { m_root = root; }
+  size_t size() const noexcept { return m_nodes.size(); }
+  std::span<const FlatNode> nodes() const noexcept { return m_nodes; }
+  std::span<const Literal> literals() const noexcept { return m_literals; }
+
+  // Replaces the arena, e.g. with tables loaded back from disk. The tables
+  // must come from a FlatAst, nothing is checked here.
+  void assign(std::span<const FlatNode> nodes,
+              std::span<const Literal> literals, NodeIndex root) {
+    m_nodes.assign(nodes.begin(), nodes.end());
+    m_literals.assign(literals.begin(), literals.end());
+    m_root = root;
+  }
+
+  // Drops every tree in the arena but keeps the memory for the next parse
+  void reset() noexcept {
+    m_nodes.clear();
+    m_literals.clear();
+    m_root = invalid_node;
+  }
+
+private:
+  NodeIndex add_node(FlatNode node) {
+    m_nodes.push_back(node);
+    return NodeIndex{static_cast<std::uint32_t>(m_nodes.size() - 1)};
+  }
+
+  std::vector<FlatNode> m_nodes;
+  std::vector<Literal> m_literals;
+  NodeIndex m_root = invalid_node;
+};
+
+// Sub tree of a FlatAst, formats the same way as the equivalent Expr
+struct FlatExpr {
+  const FlatAst &ast;
+  NodeIndex index;
+};
+
+namespace fmt {
+template <> struct formatter<FlatExpr> {
+
+  constexpr auto parse(format_parse_context &ctx)
+      -> format_parse_context::iterator {
+    auto it = ctx.begin(), end = ctx.end();
+    return it;
+  }
+
+  auto format(const FlatExpr &t, format_context &ctx) const
+      -> format_context::iterator {
+    const auto &node = t.ast.node(t.index);
+    switch (node.kind) {
+    case NodeKind::Constant:
+      return fmt::format_to(ctx.out(), "{}", t.ast.literal(node));
+    case NodeKind::Unary:
+      return fmt::format_to(ctx.out(), "({} {})", node.opr,
+                            FlatExpr{t.ast, NodeIndex{node.lhs}});
+    case NodeKind::Binary:
+      return fmt::format_to(ctx.out(), "({} {} {})",
+                            FlatExpr{t.ast, NodeIndex{node.lhs}}, node.opr,
+                            FlatExpr{t.ast, NodeIndex{node.rhs}});
+    default:
+      abort();
+    }
+  }
+};
+
+template <> struct formatter<FlatAst> : formatter<FlatExpr> {
+  auto format(const FlatAst &t, format_context &ctx) const
+      -> format_context::iterator {
+    return formatter<FlatExpr>::format(FlatExpr{t, t.root()}, ctx);
+  }
+};
+} // namespace fmt
@@ -0,0 +1,42 @@
+#include "frame_pool.hpp"
+#include <algorithm>
+#include <new>
+
+namespace {
+constexpr size_t size_class_of(size_t size, size_t granularity) noexcept {
+  return (std::max<size_t>(size, 1) + granularity - 1) / granularity;
+}
+} // namespace
+
+FramePool::~FramePool() {
+  for (auto *frame : m_free) {
+    while (frame) {
+      auto *next = frame->next;
+      ::operator delete(frame);
+      frame = next;
+    }
+  }
+}
+
+void *FramePool::allocate(size_t size) {
+  auto size_class = size_class_of(size, granularity);
+  if (size_class > size_classes) {
+    ++m_heap_allocations;
+    return ::operator new(size);
+  }
+  if (auto *frame = m_free[size_class - 1]) {
+    m_free[size_class - 1] = frame->next;
+    return frame;
+  }
+  ++m_heap_allocations;
+  return ::operator new(size_class * granularity);
+}
+
+void FramePool::deallocate(void *ptr, size_t size) noexcept {
+  auto size_class = size_class_of(size, granularity);
+  if (size_class > size_classes) {
+    ::operator delete(ptr);
+    return;
+  }
+  m_free[size_class - 1] = new (ptr) FreeFrame{m_free[size_class - 1]};
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+// Recycles coroutine frames. Frames handed back are kept on a free list per
+// size class and reused by the next coroutine of a similar size, so
+// repeatedly starting small generators stops touching the global heap after
+// the first few. Not thread safe, and it must outlive every frame taken from
+// it.
+class FramePool {
+public:
+  FramePool() = default;
+  FramePool(const FramePool &) = delete;
+  FramePool &operator=(const FramePool &) = delete;
+  ~FramePool();
+
+  void *allocate(size_t size);
+  void deallocate(void *ptr, size_t size) noexcept;
+
+  // Allocations which had to go to the global heap
+  size_t heap_allocations() const noexcept { return m_heap_allocations; }
+
+private:
+  static constexpr size_t granularity = 64;
+  // Frames above granularity * size_classes aren't pooled
+  static constexpr size_t size_classes = 64;
+
+  struct FreeFrame {
+    FreeFrame *next;
+  };
+  std::array<FreeFrame *, size_classes> m_free{};
+  size_t m_heap_allocations = 0;
+};
@@ -1,26 +1,43 @@
 #pragma once
+#include "frame_pool.hpp"
 #include <coroutine>
+#include <cstddef>
 #include <exception>
 #include <fmt/core.h>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
-#include <variant>
+
+// Lazily produced sequence of T. co_yield hands out a pointer to the yielded
+// object rather than a copy, the object lives until the generator resumes.
+//
+// Frames come from the global heap unless the coroutine takes
+// std::allocator_arg and a FramePool* as its first parameters (after the
+// object for member functions), in which case they come from that pool.
 template <typename T> class Generator {
+  using value_t = std::remove_cvref_t<T>;
+
 public:
   struct promise_type {
     auto get_return_object() noexcept { return Generator{*this}; }
     std::suspend_always initial_suspend() const noexcept { return {}; };
     std::suspend_always final_suspend() const noexcept { return {}; }
 
-    std::suspend_always yield_value(const T &val) noexcept(
-        std::is_nothrow_copy_constructible_v<T>) {
-      m_value = val;
+    std::suspend_always yield_value(value_t &val) noexcept {
+      m_value = std::addressof(val);
+      return {};
+    }
+    // Temporaries live until the end of the co_yield, which is after the
+    // consumer is done with them
+    std::suspend_always yield_value(value_t &&val) noexcept {
+      m_value = std::addressof(val);
       return {};
     }
 
     void return_void() const noexcept {}
-    void unhandled_exception() noexcept(
-        std::is_nothrow_copy_constructible_v<std::exception_ptr>) {
-      m_value = std::current_exception();
+    void unhandled_exception() noexcept {
+      m_exception = std::current_exception();
     }
 
     template <typename Expr> Expr &&await_transform(Expr &&expr) {
@@ -30,12 +47,46 @@ public:
     }
 
     void rethrow_if_fail() {
-      if (m_value.index() == 1) {
-        std::rethrow_exception(std::get<1>(m_value));
-      }
+      if (m_exception)
+        std::rethrow_exception(std::exchange(m_exception, nullptr));
     }
 
-    std::variant<T, std::exception_ptr> m_value;
+    static void *operator new(size_t size) { return allocate(size, nullptr); }
+    template <typename... Args>
+    static void *operator new(size_t size, std::allocator_arg_t,
+                              FramePool *pool, const Args &...) {
+      return allocate(size, pool);
+    }
+    template <typename Self, typename... Args>
+    static void *operator new(size_t size, const Self &, std::allocator_arg_t,
+                              FramePool *pool, const Args &...) {
+      return allocate(size, pool);
+    }
+    static void operator delete(void *frame, size_t size) noexcept {
+      auto *block = static_cast<std::byte *>(frame) - header_size;
+      auto *pool = *reinterpret_cast<FramePool **>(block);
+      if (pool)
+        pool->deallocate(block, size + header_size);
+      else
+        ::operator delete(block);
+    }
+
+    value_t *m_value = nullptr;
+    std::exception_ptr m_exception;
+
+  private:
+    // Frames are prefixed with the pool they came from, padded to keep the
+    // frame itself suitably aligned
+    static constexpr size_t header_size = alignof(std::max_align_t);
+    static_assert(sizeof(FramePool *) <= header_size);
+
+    static void *allocate(size_t size, FramePool *pool) {
+      auto *block = static_cast<std::byte *>(
+          pool ? pool->allocate(size + header_size)
+               : ::operator new(size + header_size));
+      *reinterpret_cast<FramePool **>(block) = pool;
+      return block + header_size;
+    }
   };
   using handle_t = std::coroutine_handle<promise_type>;
 
@@ -43,10 +94,10 @@ public:
 
   public:
     using iterator_category = std::input_iterator_tag;
-    using value_type = T;
+    using value_type = value_t;
     using difference_type = ptrdiff_t;
-    using pointer = T const *;
-    using reference = T const &;
+    using pointer = value_t *;
+    using reference = value_t &;
 
     iterator(handle_t handle) : m_handle(handle) {}
 
@@ -71,7 +122,8 @@ public:
 
     iterator operator++(int) = delete;
 
-    T &operator*() const { return std::get<0>(m_handle.promise().m_value); }
+    reference operator*() const { return *m_handle.promise().m_value; }
+    pointer operator->() const { return m_handle.promise().m_value; }
 
   private:
     handle_t m_handle;
@@ -84,9 +136,10 @@ public:
 
     m_handle.resume();
 
+    // The frame stays owned by the generator, it is destroyed with it
     if (m_handle.done()) {
       m_handle.promise().rethrow_if_fail();
-      m_handle = nullptr;
+      return handle_t(nullptr);
     }
     return m_handle;
   }
@@ -0,0 +1,185 @@
+#include "incremental.hpp"
+#include "number.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+using enum TokenType;
+
+IncrementalTokens::IncrementalTokens(std::span<const Step> tokens,
+                                     std::span<GroupInfo> groups,
+                                     std::string_view source,
+                                     size_t damage_begin, size_t damage_end)
+    : m_tokens(tokens), m_groups(groups), m_source(source),
+      m_damage_begin(damage_begin), m_damage_end(damage_end) {
+  require_token();
+}
+
+double IncrementalTokens::number() const noexcept {
+  return parse_number(m_tokens[m_index]->lexeme(m_source));
+}
+
+bool IncrementalTokens::next() noexcept {
+  if (m_index + 1 >= m_tokens.size())
+    return false;
+  ++m_index;
+  require_token();
+  return true;
+}
+
+std::optional<NodeIndex> IncrementalTokens::reuse_group() noexcept {
+  const auto &group = m_groups[m_index];
+  if (group.forward == 0)
+    return std::nullopt;
+  auto close = m_index + group.forward;
+  if (close >= m_damage_begin && m_index < m_damage_end)
+    return std::nullopt;
+  m_index = close;
+  next();
+  ++m_groups_reused;
+  return group.node;
+}
+
+void IncrementalTokens::close_group(NodeIndex node) noexcept {
+  auto open = m_open_groups.back();
+  m_open_groups.pop_back();
+  auto span = static_cast<std::uint32_t>(m_index - open);
+  m_groups[open].forward = span;
+  m_groups[open].node = node;
+  m_groups[m_index].backward = span;
+}
+
+void IncrementalTokens::require_token() const noexcept {
+  // TODO better error handling
+  if (!m_tokens[m_index])
+    abort();
+}
+
+IncrementalParser::IncrementalParser(std::string source, ScanBackend backend)
+    : m_scanner(backend), m_source(std::move(source)) {
+  for (auto &step : m_scanner.scan_steps(m_source, 0, 1)) {
+    m_tokens.push_back(step.result);
+    m_starts.push_back(step.start);
+    m_lines.push_back(step.line);
+  }
+  parse_all();
+}
+
+void IncrementalParser::parse_all() {
+  m_ast.reset();
+  m_groups.assign(m_tokens.size(), GroupInfo{});
+  IncrementalTokens stream(m_tokens, m_groups, m_source, 0, m_tokens.size());
+  m_parser.parse(stream, m_ast);
+  m_full_parse_size = m_ast.size();
+}
+
+EditStats IncrementalParser::edit(const Edit &edit) {
+  // TODO better error handling
+  if (edit.offset > m_source.size() ||
+      edit.removed > m_source.size() - edit.offset)
+    abort();
+
+  // The token before the edit may grow into it, "ab" + "c" is one token
+  auto first = static_cast<size_t>(
+      std::ranges::lower_bound(m_starts, edit.offset) - m_starts.begin());
+  if (first > 0)
+    --first;
+  forget_enclosing_groups(first);
+
+  auto restart = m_starts[first];
+  auto restart_line = m_lines[first];
+  m_source.replace(edit.offset, edit.removed, edit.inserted);
+
+  // Rescan until a lexer call past the edit starts where one did before,
+  // from there on the old tokens only move
+  auto inserted_end = edit.offset + edit.inserted.size();
+  std::vector<IncrementalTokens::Step> tokens;
+  std::vector<std::uint32_t> starts;
+  std::vector<std::uint32_t> lines;
+  auto sync = m_tokens.size();
+  std::uint32_t line_shift = 0;
+  for (auto &step : m_scanner.scan_steps(m_source, restart, restart_line)) {
+    if (step.start >= inserted_end) {
+      auto old_start = step.start - edit.inserted.size() + edit.removed;
+      auto itr = std::lower_bound(m_starts.begin() + static_cast<ptrdiff_t>(first),
+                                  m_starts.end(), old_start);
+      if (itr != m_starts.end() && *itr == old_start) {
+        sync = static_cast<size_t>(itr - m_starts.begin());
+        line_shift = step.line - m_lines[sync];
+        break;
+      }
+    }
+    tokens.push_back(step.result);
+    starts.push_back(step.start);
+    lines.push_back(step.line);
+  }
+  for (auto i = first; i < sync; ++i)
+    forget_group(i);
+
+  // Splice the new tokens in, unsigned wrap shifts the rest either way
+  auto from = static_cast<ptrdiff_t>(first);
+  auto to = static_cast<ptrdiff_t>(sync);
+  m_tokens.erase(m_tokens.begin() + from, m_tokens.begin() + to);
+  m_tokens.insert(m_tokens.begin() + from, tokens.begin(), tokens.end());
+  m_starts.erase(m_starts.begin() + from, m_starts.begin() + to);
+  m_starts.insert(m_starts.begin() + from, starts.begin(), starts.end());
+  m_lines.erase(m_lines.begin() + from, m_lines.begin() + to);
+  m_lines.insert(m_lines.begin() + from, lines.begin(), lines.end());
+  m_groups.erase(m_groups.begin() + from, m_groups.begin() + to);
+  m_groups.insert(m_groups.begin() + from, tokens.size(), GroupInfo{});
+
+  auto offset_shift =
+      static_cast<std::uint32_t>(edit.inserted.size() - edit.removed);
+  for (auto i = first + tokens.size(); i < m_tokens.size(); ++i) {
+    m_starts[i] += offset_shift;
+    m_lines[i] += line_shift;
+    if (auto &token = m_tokens[i]) {
+      token->offset += offset_shift;
+      token->line += line_shift;
+    }
+  }
+
+  EditStats stats{tokens.size(), m_tokens.size() - tokens.size(), 0, 0};
+  auto nodes_before = m_ast.size();
+  // Unreachable nodes pile up, start over once they outweigh the tree
+  if (nodes_before > 2 * m_full_parse_size + 1024) {
+    parse_all();
+    stats.nodes_added = m_ast.size();
+    return stats;
+  }
+  IncrementalTokens stream(m_tokens, m_groups, m_source, first,
+                           first + tokens.size());
+  m_parser.parse(stream, m_ast);
+  stats.nodes_added = m_ast.size() - nodes_before;
+  stats.groups_reused = stream.groups_reused();
+  return stats;
+}
+
+// Groups around index are being edited, walking back from index every '('
+// not closed before index opens one of them
+void IncrementalParser::forget_enclosing_groups(size_t index) noexcept {
+  size_t depth = 0;
+  for (auto i = index; i-- > 0;) {
+    if (!m_tokens[i])
+      continue;
+    if (m_tokens[i]->type == RightParen) {
+      // Jump over groups known to be complete
+      if (auto back = m_groups[i].backward) {
+        i -= back;
+        continue;
+      }
+      ++depth;
+    } else if (m_tokens[i]->type == LeftParen) {
+      if (depth == 0)
+        forget_group(i);
+      else
+        --depth;
+    }
+  }
+}
+
+void IncrementalParser::forget_group(size_t open) noexcept {
+  auto &group = m_groups[open];
+  if (group.forward != 0)
+    m_groups[open + group.forward].backward = 0;
+  group = GroupInfo{};
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include "flat_ast.hpp"
+#include "parser.hpp"
+#include "scanner.hpp"
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Replaces removed bytes at offset with inserted
+struct Edit {
+  size_t offset;
+  size_t removed;
+  std::string_view inserted;
+};
+
+struct EditStats {
+  size_t tokens_scanned;
+  size_t tokens_reused;
+  // Nodes the reparse added to the tree
+  size_t nodes_added;
+  // Parenthesized groups whose subtrees were kept as they were
+  size_t groups_reused;
+};
+
+// Group of parens as last parsed, kept on both of its paren tokens. Spans
+// are relative, so they stay right when tokens before them come and go.
+struct GroupInfo {
+  // On '(': tokens up to its ')', 0 when not known
+  std::uint32_t forward = 0;
+  // On ')': tokens back to its '(', 0 when not known
+  std::uint32_t backward = 0;
+  NodeIndex node = invalid_node;
+};
+
+// Token stream IncrementalParser parses from. Groups lying completely
+// outside the tokens an edit rescanned are handed to the parser as they
+// are, skipping their tokens.
+class IncrementalTokens {
+public:
+  using Step = std::expected<CompactToken, ScanError>;
+  IncrementalTokens(std::span<const Step> tokens, std::span<GroupInfo> groups,
+                    std::string_view source, size_t damage_begin,
+                    size_t damage_end);
+
+  TokenType type() const noexcept { return m_tokens[m_index]->type; }
+  double number() const noexcept;
+  Value string() const noexcept {
+    return Value::string(m_tokens[m_index]->lexeme(m_source));
+  }
+  // Return true token are available, stays on the last token
+  bool next() noexcept;
+
+  std::optional<NodeIndex> reuse_group() noexcept;
+  void open_group() { m_open_groups.push_back(m_index - 1); }
+  void close_group(NodeIndex node) noexcept;
+
+  size_t groups_reused() const noexcept { return m_groups_reused; }
+
+private:
+  void require_token() const noexcept;
+
+  std::span<const Step> m_tokens;
+  std::span<GroupInfo> m_groups;
+  std::string_view m_source;
+  size_t m_damage_begin;
+  size_t m_damage_end;
+  size_t m_index = 0;
+  std::vector<size_t> m_open_groups;
+  size_t m_groups_reused = 0;
+};
+
+// Keeps the tokens and tree of a source which is edited over and over,
+// such as an editor buffer. An edit rescans from the token before it until
+// the scanner falls back in step with the old tokens. It then reparses,
+// taking over the subtrees of groups the rescan didn't touch, so the work
+// follows the edit and the nesting around it rather than the source size.
+class IncrementalParser {
+public:
+  explicit IncrementalParser(std::string source,
+                             ScanBackend backend = ScanBackend::Switch);
+
+  EditStats edit(const Edit &edit);
+
+  std::string_view source() const noexcept { return m_source; }
+  std::span<const IncrementalTokens::Step> tokens() const noexcept {
+    return m_tokens;
+  }
+  // Nodes of earlier parses no longer reachable from root() stay until the
+  // tree grows enough to be worth parsing again from scratch
+  const FlatAst &ast() const noexcept { return m_ast; }
+  NodeIndex root() const noexcept { return m_ast.root(); }
+
+private:
+  void parse_all();
+  void forget_enclosing_groups(size_t index) noexcept;
+  void forget_group(size_t open) noexcept;
+
+  Scanner m_scanner;
+  Parser m_parser;
+  std::string m_source;
+  // Per token, where the lexer call producing it started and the lines
+  // before that
+  std::vector<IncrementalTokens::Step> m_tokens;
+  std::vector<std::uint32_t> m_starts;
+  std::vector<std::uint32_t> m_lines;
+  std::vector<GroupInfo> m_groups;
+  FlatAst m_ast;
+  size_t m_full_parse_size = 0;
+};
@@ -0,0 +1,40 @@
+#include "interner.hpp"
+#include "trace.hpp"
+#include <mutex>
+
+InternedString StringInterner::intern(std::string_view str) {
+  m_lookups.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::shared_lock lock(m_mutex);
+    if (auto itr = m_table.find(str); itr != m_table.end()) {
+      m_hits.fetch_add(1, std::memory_order_relaxed);
+      m_bytes_saved.fetch_add(str.size(), std::memory_order_relaxed);
+      return InternedString(itr->second);
+    }
+  }
+
+  std::unique_lock lock(m_mutex);
+  // Someone may have inserted it between the two locks
+  if (auto itr = m_table.find(str); itr != m_table.end()) {
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    m_bytes_saved.fetch_add(str.size(), std::memory_order_relaxed);
+    return InternedString(itr->second);
+  }
+  const auto &stored = m_strings.emplace_back(str);
+  m_table.emplace(stored, &stored);
+  m_bytes_stored += stored.size();
+  JLOX_TRACE_COUNT(LexemeBytes, stored.size());
+  return InternedString(&stored);
+}
+
+InternStats StringInterner::stats() const noexcept {
+  std::shared_lock lock(m_mutex);
+  return {m_lookups.load(std::memory_order_relaxed),
+          m_hits.load(std::memory_order_relaxed), m_strings.size(),
+          m_bytes_stored, m_bytes_saved.load(std::memory_order_relaxed)};
+}
+
+StringInterner &StringInterner::global() {
+  static StringInterner interner;
+  return interner;
+}
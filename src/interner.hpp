@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Handle to a string owned by a StringInterner. Equal strings interned in
+// the same interner share one handle, so comparing handles is a pointer
+// comparison.
+class InternedString {
+public:
+  constexpr InternedString() noexcept = default;
+  explicit constexpr InternedString(const std::string *str) noexcept
+      : m_str(str) {}
+
+  std::string_view view() const noexcept {
+    return m_str ? std::string_view(*m_str) : std::string_view();
+  }
+  constexpr const std::string *get() const noexcept { return m_str; }
+
+  constexpr bool operator==(const InternedString &) const noexcept = default;
+
+private:
+  const std::string *m_str = nullptr;
+};
+
+struct InternStats {
+  size_t lookups;
+  size_t hits;
+  size_t unique_strings;
+  // Bytes held by the interner
+  size_t bytes_stored;
+  // Bytes that would have been copied again if every lookup made a string
+  size_t bytes_saved;
+
+  double hit_ratio() const noexcept {
+    return lookups ? static_cast<double>(hits) / static_cast<double>(lookups)
+                   : 0;
+  }
+};
+
+// Deduplicates strings into stable InternedString handles. Strings are never
+// released, the interner only grows with the number of distinct strings.
+// Safe to use from several threads at once.
+class StringInterner {
+public:
+  InternedString intern(std::string_view str);
+  InternStats stats() const noexcept;
+
+  // Shared by Scanner, Parser and Interpreter
+  static StringInterner &global();
+
+private:
+  mutable std::shared_mutex m_mutex;
+  // deque never moves its elements, so handles stay valid while it grows
+  std::deque<std::string> m_strings;
+  // Keys point into m_strings
+  std::unordered_map<std::string_view, const std::string *> m_table;
+  size_t m_bytes_stored = 0;
+
+  std::atomic<size_t> m_lookups{0};
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_bytes_saved{0};
+};
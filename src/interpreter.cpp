@@ -3,19 +3,19 @@
 #include <cstdlib>
 
 using enum TokenType;
-Literal Interpreter::perform_unary_op(Literal operand,
-                                      TokenType opr) const noexcept {
+Value Interpreter::perform_unary_op(Value operand,
+                                    TokenType opr) const noexcept {
   // TODO better error handling;
   switch (opr) {
   case Bang: {
-    if (std::holds_alternative<bool>(operand))
-      return Literal(!std::get<bool>(operand));
+    if (operand.is_bool())
+      return !operand.as_bool();
     // TODO better error handling
     abort();
   }
   case Minus: {
-    if (std::holds_alternative<float>(operand))
-      return Literal(-1 * std::get<float>(operand));
+    if (operand.is_number())
+      return negate_number(operand);
   }
     // TODO better error handling
     abort();
@@ -24,38 +24,55 @@ Literal Interpreter::perform_unary_op(Literal operand,
   abort();
 }
 
-template <typename... Args> inline bool is_workable_types(const Literal &obj) {
-  return (std::holds_alternative<Args>(obj) || ...);
+Value Interpreter::evaluate(const FlatAst &ast,
+                            NodeIndex index) const noexcept {
+  JLOX_TRACE_COUNT(Evaluations, 1);
+  const auto &node = ast.node(index);
+  switch (node.kind) {
+  case NodeKind::Constant:
+    return ast.literal(node);
+  case NodeKind::Unary:
+    return perform_unary_op(evaluate(ast, NodeIndex{node.lhs}), node.opr);
+  case NodeKind::Binary: {
+    auto value_left = evaluate(ast, NodeIndex{node.lhs});
+    auto value_right = evaluate(ast, NodeIndex{node.rhs});
+    return perform_binary_op(value_left, node.opr, value_right);
+  }
+  }
+  // TODO better error handling
+  abort();
 }
 
-Literal Interpreter::perform_binary_op(Literal left_operand, TokenType opr,
-                                       Literal right_operand) const noexcept {
+template <ValueType... Types> inline bool is_workable_types(Value obj) {
+  return ((obj.type() == Types) || ...);
+}
+
+inline bool is_comparable(Value obj) {
+  return is_workable_types<ValueType::Number, ValueType::String>(obj);
+}
+
+// TODO better error handling
+inline void require_numbers(Value left, Value right) noexcept {
+  if (!left.is_number() || !right.is_number())
+    abort();
+}
+
+Value Interpreter::perform_binary_op(Value left_operand, TokenType opr,
+                                     Value right_operand) const noexcept {
   switch (opr) {
     // TODO better error handling
   case Plus:
-    // assert(left_operand.value.has_value() &&
-    // right_operand.value.has_value());
-    // fmt::print("{} {}", std::get<float>(left_operand),
-    //            std::get<float>(right_operand));
-    return std::get<float>(left_operand) + std::get<float>(right_operand);
+    require_numbers(left_operand, right_operand);
+    return add_numbers(left_operand, right_operand);
   case Minus:
-    // assert(left_operand.value.has_value() &&
-    // right_operand.value.has_value());
-    // fmt::print("{} {}", std::get<float>(left_operand),
-    //            std::get<float>(right_operand));
-    return std::get<float>(left_operand) - std::get<float>(right_operand);
+    require_numbers(left_operand, right_operand);
+    return subtract_numbers(left_operand, right_operand);
   case Star:
-    // assert(left_operand.value.has_value() &&
-    // right_operand.value.has_value());
-    // fmt::print("{} {}", std::get<float>(left_operand),
-    //            std::get<float>(right_operand));
-    return std::get<float>(left_operand) * std::get<float>(right_operand);
+    require_numbers(left_operand, right_operand);
+    return multiply_numbers(left_operand, right_operand);
   case Slash:
-    // assert(left_operand.value.has_value() &&
-    // right_operand.value.has_value());
-    // fmt::print("{} {}", std::get<float>(left_operand),
-    //            std::get<float>(right_operand));
-    return std::get<float>(left_operand) / std::get<float>(right_operand);
+    require_numbers(left_operand, right_operand);
+    return divide_numbers(left_operand, right_operand);
   case BangEqual: {
     return left_operand != right_operand;
   }
@@ -63,26 +80,52 @@ Literal Interpreter::perform_binary_op(Literal left_operand, TokenType opr,
     return left_operand == right_operand;
   }
   case Greater: {
-    {
-      assert((is_workable_types<float, std::string>(left_operand)) &&
-             (is_workable_types<float, std::string>(right_operand)));
-      return left_operand > right_operand;
-    }
+    assert(is_comparable(left_operand) && is_comparable(right_operand));
+    return left_operand > right_operand;
   }
   case GreaterEqual: {
-    assert((is_workable_types<float, std::string>(left_operand)) &&
-           (is_workable_types<float, std::string>(right_operand)));
+    assert(is_comparable(left_operand) && is_comparable(right_operand));
     return left_operand >= right_operand;
   }
   case Less: {
-    assert((is_workable_types<float, std::string>(left_operand)) &&
-           (is_workable_types<float, std::string>(right_operand)));
+    assert(is_comparable(left_operand) && is_comparable(right_operand));
     return left_operand < right_operand;
   }
   case LessEqual: {
-    assert((is_workable_types<float, std::string>(left_operand)) &&
-           (is_workable_types<float, std::string>(right_operand)));
+    assert(is_comparable(left_operand) && is_comparable(right_operand));
     return left_operand <= right_operand;
   }
   }
+  // TODO better error handling
+  abort();
+}
+
+bool Interpreter::can_perform_unary_op(Value operand, TokenType opr) noexcept {
+  switch (opr) {
+  case Bang:
+    return operand.is_bool();
+  case Minus:
+    return operand.is_number();
+  }
+  return false;
+}
+
+bool Interpreter::can_perform_binary_op(Value left_operand, TokenType opr,
+                                        Value right_operand) noexcept {
+  switch (opr) {
+  case Plus:
+  case Minus:
+  case Star:
+  case Slash:
+    return left_operand.is_number() && right_operand.is_number();
+  case BangEqual:
+  case Equal:
+    return true;
+  case Greater:
+  case GreaterEqual:
+  case Less:
+  case LessEqual:
+    return is_comparable(left_operand) && is_comparable(right_operand);
+  }
+  return false;
 }
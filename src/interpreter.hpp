@@ -1,5 +1,7 @@
 #pragma once
+#include "flat_ast.hpp"
 #include "parser.hpp"
+#include "trace.hpp"
 
 using UnaryExprPtr = std::unique_ptr<UnaryExpr>;
 using BinaryExprPtr = std::unique_ptr<BinaryExpr>;
@@ -7,16 +9,36 @@ using LiteralPtr = std::unique_ptr<Literal>;
 
 class Interpreter {
 public:
-  auto operator()(const LiteralPtr &l) const noexcept { return *l; }
+  auto operator()(const LiteralPtr &l) const noexcept {
+    JLOX_TRACE_COUNT(Evaluations, 1);
+    return *l;
+  }
   auto operator()(const UnaryExprPtr &expr) const noexcept {
     return evaluate_unary(*expr);
   }
   auto operator()(const BinaryExprPtr &expr) const noexcept {
     return evaluate_binary(*expr);
   }
+  Value operator()(const FlatAst &ast) const noexcept {
+    JLOX_TRACE_SCOPE("Interpreter");
+    return evaluate(ast, ast.root());
+  }
+  // Any tree of ast, for arenas holding several
+  Value operator()(const FlatAst &ast, NodeIndex root) const noexcept {
+    return evaluate(ast, root);
+  }
+
+  Value perform_unary_op(Value operand, TokenType opr) const noexcept;
+  Value perform_binary_op(Value left_operand, TokenType opr,
+                          Value right_operand) const noexcept;
+  // Whether perform_unary_op/perform_binary_op produce a value for these
+  // operands rather than failing
+  static bool can_perform_unary_op(Value operand, TokenType opr) noexcept;
+  static bool can_perform_binary_op(Value left_operand, TokenType opr,
+                                    Value right_operand) noexcept;
 
 private:
-  Literal evaluate(const Expr &expr) const noexcept {
+  Value evaluate(const Expr &expr) const noexcept {
     if (std::holds_alternative<std::unique_ptr<UnaryExpr>>(expr))
       return evaluate_unary(*std::get<std::unique_ptr<UnaryExpr>>(expr));
     else if (std::holds_alternative<std::unique_ptr<BinaryExpr>>(expr))
@@ -25,17 +47,17 @@ private:
       return operator()(std::get<LiteralPtr>(expr));
   }
 
-  Literal evaluate_unary(const UnaryExpr &expr) const noexcept {
+  Value evaluate(const FlatAst &ast, NodeIndex index) const noexcept;
+
+  Value evaluate_unary(const UnaryExpr &expr) const noexcept {
+    JLOX_TRACE_COUNT(Evaluations, 1);
     auto value = evaluate(expr.expr);
     return perform_unary_op(value, expr.opr);
   }
-  Literal evaluate_binary(const BinaryExpr &expr) const noexcept {
+  Value evaluate_binary(const BinaryExpr &expr) const noexcept {
+    JLOX_TRACE_COUNT(Evaluations, 1);
     auto value_left = evaluate(expr.lexpr);
     auto value_right = evaluate(expr.rexpr);
     return perform_binary_op(value_left, expr.opr, value_right);
   }
-
-  Literal perform_unary_op(Literal operand, TokenType opr) const noexcept;
-  Literal perform_binary_op(Literal left_operand, TokenType opr,
-                            Literal right_operand) const noexcept;
 };
@@ -0,0 +1,68 @@
+#pragma once
+#include "token.hpp"
+#include <string_view>
+
+// Keyword token type for str, or Identifier. Dispatches on length and then
+// on the first char, so recognizing a keyword is at most two jumps and one
+// short compare with nothing to hash or build at runtime.
+constexpr TokenType identifier_type(std::string_view str) noexcept {
+  using enum TokenType;
+  auto is = [str](std::string_view keyword) { return str == keyword; };
+  switch (str.size()) {
+  case 2:
+    switch (str[0]) {
+    case 'i':
+      return is("if") ? If : Identifier;
+    case 'o':
+      return is("or") ? Or : Identifier;
+    default:
+      return Identifier;
+    }
+  case 3:
+    switch (str[0]) {
+    case 'a':
+      return is("and") ? And : Identifier;
+    case 'd':
+      return is("def") ? Def : Identifier;
+    case 'f':
+      return is("for") ? For : Identifier;
+    case 'n':
+      return is("nil") ? Nil : Identifier;
+    case 'v':
+      return is("var") ? Var : Identifier;
+    default:
+      return Identifier;
+    }
+  case 4:
+    switch (str[0]) {
+    case 'e':
+      return is("else") ? Else : Identifier;
+    case 't':
+      return is("true") ? True : is("this") ? This : Identifier;
+    default:
+      return Identifier;
+    }
+  case 5:
+    switch (str[0]) {
+    case 'c':
+      return is("class") ? Class : Identifier;
+    case 'f':
+      return is("false") ? False : Identifier;
+    case 's':
+      return is("super") ? Super : Identifier;
+    case 'w':
+      return is("while") ? While : Identifier;
+    default:
+      return Identifier;
+    }
+  case 6:
+    return is("return") ? Return : Identifier;
+  default:
+    return Identifier;
+  }
+}
+
+static_assert(identifier_type("while") == TokenType::While);
+static_assert(identifier_type("this") == TokenType::This);
+static_assert(identifier_type("thus") == TokenType::Identifier);
+static_assert(identifier_type("") == TokenType::Identifier);
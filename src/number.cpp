@@ -0,0 +1,72 @@
+#include "number.hpp"
+#include <array>
+#include <charconv>
+#include <cstdlib>
+
+namespace {
+constexpr std::array<double, 23> powers_of_ten = [] {
+  std::array<double, 23> powers{};
+  double power = 1;
+  for (auto &p : powers) {
+    p = power;
+    power *= 10;
+  }
+  return powers;
+}();
+
+// Eight digits read as a little endian word, the first one most significant
+inline std::uint64_t eight_digits(std::uint64_t word) noexcept {
+  auto x = word - 0x3030303030303030;
+  x = (x * 10 + (x >> 8)) & 0x00ff00ff00ff00ff;
+  x = (x * 100 + (x >> 16)) & 0x0000ffff0000ffff;
+  return (x * 10000 + (x >> 32)) & 0xffffffff;
+}
+
+// Appends the digits of run to mantissa
+inline std::uint64_t accumulate(std::uint64_t mantissa,
+                                std::string_view run) noexcept {
+  size_t i = 0;
+  if constexpr (std::endian::native == std::endian::little) {
+    for (; i + 8 <= run.size(); i += 8) {
+      std::uint64_t word;
+      std::memcpy(&word, run.data() + i, sizeof(word));
+      mantissa = mantissa * 100000000 + eight_digits(word);
+    }
+  }
+  for (; i < run.size(); ++i)
+    mantissa = mantissa * 10 + static_cast<std::uint64_t>(run[i] - '0');
+  return mantissa;
+}
+
+double parse_slow(std::string_view lexeme) noexcept {
+  double value = 0;
+  auto [ptr, ec] =
+      std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+  // TODO better error handling
+  if (ec != std::errc())
+    abort();
+  return value;
+}
+} // namespace
+
+double parse_number(std::string_view lexeme) noexcept {
+  auto integer_digits = digit_run(lexeme);
+  auto integer = lexeme.substr(0, integer_digits);
+  std::string_view fraction;
+  if (integer_digits + 1 < lexeme.size() && lexeme[integer_digits] == '.') {
+    fraction = lexeme.substr(integer_digits + 1);
+    fraction = fraction.substr(0, digit_run(fraction));
+  }
+  auto parsed = integer.size() + (fraction.empty() ? 0 : fraction.size() + 1);
+  // 19 digits can't overflow 64 bits
+  if (integer_digits == 0 || parsed != lexeme.size() ||
+      integer.size() + fraction.size() > 19)
+    return parse_slow(lexeme);
+
+  auto mantissa = accumulate(accumulate(0, integer), fraction);
+  // Both operands are exact doubles, so the one division rounds correctly
+  if (mantissa > (std::uint64_t{1} << 53) ||
+      fraction.size() >= powers_of_ten.size())
+    return parse_slow(lexeme);
+  return static_cast<double>(mantissa) / powers_of_ten[fraction.size()];
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Number lexemes are digits with an optional fraction, "12" or "12.5".
+// These work on them in place in the source, eight digits at a time.
+
+constexpr bool is_digit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+// Length of the run of digits str starts with
+inline size_t digit_run(std::string_view str) noexcept {
+  size_t i = 0;
+  if constexpr (std::endian::native == std::endian::little) {
+    for (; i + 8 <= str.size(); i += 8) {
+      std::uint64_t word;
+      std::memcpy(&word, str.data() + i, sizeof(word));
+      // Digits become 0-9, every other byte ends up with its top bit set.
+      // A carry out of a byte only ever follows a non digit.
+      auto x = word ^ 0x3030303030303030;
+      auto non_digits = ((x + 0x7676767676767676) | x) & 0x8080808080808080;
+      if (non_digits)
+        return i + static_cast<size_t>(std::countr_zero(non_digits)) / 8;
+    }
+  }
+  while (i < str.size() && is_digit(str[i]))
+    ++i;
+  return i;
+}
+
+// Value of a number lexeme. Exact for up to 19 significant digits with a
+// mantissa below 2^53 and at most 22 fraction digits, which covers the
+// usual literals, anything else goes through std::from_chars.
+double parse_number(std::string_view lexeme) noexcept;
@@ -0,0 +1,147 @@
+#include "optimizer.hpp"
+#include "interpreter.hpp"
+#include <optional>
+
+using enum TokenType;
+
+namespace {
+// Type the expression evaluates to if it doesn't fail, every operator has a
+// fixed result type
+std::optional<ValueType> static_type(const Expr &expr) noexcept {
+  if (const auto *literal = std::get_if<LiteralPtr>(&expr))
+    return *literal ? std::optional((*literal)->type()) : std::nullopt;
+  if (const auto *unary = std::get_if<UnaryExprPtr>(&expr))
+    return (*unary)->opr == Bang ? ValueType::Bool : ValueType::Number;
+  switch (std::get<BinaryExprPtr>(expr)->opr) {
+  case Plus:
+  case Minus:
+  case Star:
+  case Slash:
+    return ValueType::Number;
+  default:
+    return ValueType::Bool;
+  }
+}
+
+// Value of a literal node, nothing for the empty expression or operators
+std::optional<Value> constant(const Expr &expr) noexcept {
+  const auto *literal = std::get_if<LiteralPtr>(&expr);
+  if (!literal || !*literal)
+    return std::nullopt;
+  return **literal;
+}
+
+bool is_number(const Expr &expr, double number) noexcept {
+  auto value = constant(expr);
+  return value && value->is_number() && value->as_number() == number;
+}
+
+// Applies rewrite to every node, children first
+template <typename F> void rewrite_bottom_up(Expr &expr, F &rewrite) {
+  if (auto *unary = std::get_if<UnaryExprPtr>(&expr)) {
+    rewrite_bottom_up((*unary)->expr, rewrite);
+  } else if (auto *binary = std::get_if<BinaryExprPtr>(&expr)) {
+    rewrite_bottom_up((*binary)->lexpr, rewrite);
+    rewrite_bottom_up((*binary)->rexpr, rewrite);
+  }
+  rewrite(expr);
+}
+} // namespace
+
+size_t count_nodes(const Expr &expr) noexcept {
+  if (const auto *unary = std::get_if<UnaryExprPtr>(&expr))
+    return 1 + count_nodes((*unary)->expr);
+  if (const auto *binary = std::get_if<BinaryExprPtr>(&expr))
+    return 1 + count_nodes((*binary)->lexpr) + count_nodes((*binary)->rexpr);
+  return std::get<LiteralPtr>(expr) ? 1 : 0;
+}
+
+void fold_constants(Expr &expr) {
+  Interpreter interpreter;
+  auto fold = [&interpreter](Expr &node) {
+    if (auto *unary = std::get_if<UnaryExprPtr>(&node)) {
+      auto operand = constant((*unary)->expr);
+      // Operations which would fail are left to fail at run time
+      if (operand &&
+          Interpreter::can_perform_unary_op(*operand, (*unary)->opr))
+        node = std::make_unique<Literal>(
+            interpreter.perform_unary_op(*operand, (*unary)->opr));
+    } else if (auto *binary = std::get_if<BinaryExprPtr>(&node)) {
+      auto left = constant((*binary)->lexpr);
+      auto right = constant((*binary)->rexpr);
+      if (left && right &&
+          Interpreter::can_perform_binary_op(*left, (*binary)->opr, *right))
+        node = std::make_unique<Literal>(
+            interpreter.perform_binary_op(*left, (*binary)->opr, *right));
+    }
+  };
+  rewrite_bottom_up(expr, fold);
+}
+
+void eliminate_double_negation(Expr &expr) {
+  auto eliminate = [](Expr &node) {
+    auto *outer = std::get_if<UnaryExprPtr>(&node);
+    if (!outer)
+      return;
+    auto *inner = std::get_if<UnaryExprPtr>(&(*outer)->expr);
+    if (!inner || (*inner)->opr != (*outer)->opr)
+      return;
+    // -(-x) fails for anything but a number, which must stay that way
+    auto wanted = (*outer)->opr == Bang ? ValueType::Bool : ValueType::Number;
+    if (static_type((*inner)->expr) != wanted)
+      return;
+    // Moved out first, assigning destroys the nodes owning it
+    auto operand = std::move((*inner)->expr);
+    node = std::move(operand);
+  };
+  rewrite_bottom_up(expr, eliminate);
+}
+
+void simplify_identities(Expr &expr) {
+  // x + 0 isn't among them, -0 + 0 is 0
+  auto simplify = [](Expr &node) {
+    auto *binary = std::get_if<BinaryExprPtr>(&node);
+    if (!binary)
+      return;
+    auto &[lexpr, opr, rexpr] = **binary;
+    Expr *kept = nullptr;
+    if ((opr == Minus && is_number(rexpr, 0)) ||
+        ((opr == Star || opr == Slash) && is_number(rexpr, 1)))
+      kept = &lexpr;
+    else if (opr == Star && is_number(lexpr, 1))
+      kept = &rexpr;
+    // x * 1 on a string fails, which must stay that way
+    if (!kept || static_type(*kept) != ValueType::Number)
+      return;
+    auto operand = std::move(*kept);
+    node = std::move(operand);
+  };
+  rewrite_bottom_up(expr, simplify);
+}
+
+PassManager &PassManager::add(std::string name, Pass pass) {
+  m_passes.push_back({std::move(name), std::move(pass)});
+  return *this;
+}
+
+PassManager PassManager::with_default_passes() {
+  PassManager manager;
+  manager.add("fold_constants", fold_constants)
+      .add("eliminate_double_negation", eliminate_double_negation)
+      .add("simplify_identities", simplify_identities);
+  return manager;
+}
+
+std::vector<PassStats> PassManager::run(Expr &expr) const {
+  using Clock = std::chrono::steady_clock;
+  std::vector<PassStats> stats;
+  stats.reserve(m_passes.size());
+  for (const auto &[name, pass] : m_passes) {
+    auto nodes_before = count_nodes(expr);
+    auto start = Clock::now();
+    pass(expr);
+    auto time = Clock::now() - start;
+    stats.push_back({name, nodes_before, count_nodes(expr), time});
+  }
+  return stats;
+}
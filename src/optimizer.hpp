@@ -0,0 +1,62 @@
+#pragma once
+#include "parser.hpp"
+#include <chrono>
+#include <fmt/format.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Nodes in the tree, the empty expression counts for none
+size_t count_nodes(const Expr &expr) noexcept;
+
+// Rewrites evaluating to the same Value, or failing the same way, as the
+// original expression
+void fold_constants(Expr &expr);
+// --x and !!x to x when x is known to be a number (bool)
+void eliminate_double_negation(Expr &expr);
+// x - 0, x * 1, 1 * x and x / 1 to x when x is known to be a number
+void simplify_identities(Expr &expr);
+
+struct PassStats {
+  std::string name;
+  size_t nodes_before;
+  size_t nodes_after;
+  std::chrono::nanoseconds time;
+
+  size_t nodes_removed() const noexcept { return nodes_before - nodes_after; }
+};
+
+// Runs rewrite passes over an Expr in the order they were added
+class PassManager {
+public:
+  using Pass = std::function<void(Expr &)>;
+
+  PassManager &add(std::string name, Pass pass);
+  // Constant folding, double negation and identity simplification
+  static PassManager with_default_passes();
+
+  std::vector<PassStats> run(Expr &expr) const;
+
+private:
+  struct NamedPass {
+    std::string name;
+    Pass pass;
+  };
+  std::vector<NamedPass> m_passes;
+};
+
+namespace fmt {
+template <> struct formatter<PassStats> {
+  constexpr auto parse(format_parse_context &ctx)
+      -> format_parse_context::iterator {
+    return ctx.begin();
+  }
+
+  auto format(const PassStats &stats, format_context &ctx) const
+      -> format_context::iterator {
+    return fmt::format_to(ctx.out(), "{}: {} -> {} nodes in {}ns", stats.name,
+                          stats.nodes_before, stats.nodes_after,
+                          stats.time.count());
+  }
+};
+} // namespace fmt
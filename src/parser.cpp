@@ -1,134 +1,428 @@
 #include "parser.hpp"
+#include "flat_ast.hpp"
+#include "incremental.hpp"
+#include "number.hpp"
+#include "token_batch.hpp"
+#include "trace.hpp"
+#include <array>
+#include <cstdlib>
+#include <utility>
+#include <vector>
 
 using enum TokenType;
-// TODO make m_token_stream better, I think this design may pose difficulty
-// later on
+
+namespace {
+// Binding power of infix operators, 0 for everything else. Operators of
+// higher power group first.
+constexpr std::uint8_t lowest_power = 1;
+constexpr auto binding_powers = [] {
+  std::array<std::uint8_t, static_cast<size_t>(TokenType::Def) + 1> powers{};
+  auto set = [&powers](std::uint8_t power, auto... types) {
+    ((powers[static_cast<size_t>(types)] = power), ...);
+  };
+  set(1, Equal, BangEqual);
+  set(2, Greater, GreaterEqual, Less, LessEqual);
+  set(3, Plus, Minus);
+  set(4, Star, Slash);
+  return powers;
+}();
+// Operand of a prefix operator takes no infix operators at all
+constexpr std::uint8_t prefix_power = 5;
+
+constexpr std::uint8_t binding_power(TokenType type) noexcept {
+  return binding_powers[static_cast<size_t>(type)];
+}
+
+// Takes over the subtree of a group from an earlier parse, when the stream
+// keeps them and the group is unchanged
+template <typename Tokens, typename Node>
+bool reuse_group(Tokens &tokens, Node &expr) noexcept {
+  if constexpr (GroupCachingStream<Tokens>) {
+    if (tokens.type() == LeftParen) {
+      if (auto group = tokens.reuse_group()) {
+        expr = *group;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Every node is its own heap allocation
+struct TreeBuilder {
+  using Node = Expr;
+  Node literal(Literal value) {
+    JLOX_TRACE_COUNT(Nodes, 1);
+    return std::make_unique<Literal>(value);
+  }
+  Node unary(TokenType opr, Node expr) {
+    JLOX_TRACE_COUNT(Nodes, 1);
+    return std::make_unique<UnaryExpr>(opr, std::move(expr));
+  }
+  Node binary(Node lexpr, TokenType opr, Node rexpr) {
+    JLOX_TRACE_COUNT(Nodes, 1);
+    return std::make_unique<BinaryExpr>(std::move(lexpr), opr,
+                                        std::move(rexpr));
+  }
+  Node empty() { return {}; }
+};
+
+// Nodes are appended to a FlatAst and referred to by index
+struct FlatBuilder {
+  using Node = NodeIndex;
+  FlatAst &ast;
+  Node literal(Literal value) {
+    JLOX_TRACE_COUNT(Nodes, 1);
+    return ast.add_literal(value);
+  }
+  Node unary(TokenType opr, Node expr) {
+    JLOX_TRACE_COUNT(Nodes, 1);
+    return ast.add_unary(opr, expr);
+  }
+  Node binary(Node lexpr, TokenType opr, Node rexpr) {
+    JLOX_TRACE_COUNT(Nodes, 1);
+    return ast.add_binary(lexpr, opr, rexpr);
+  }
+  Node empty() { return invalid_node; }
+};
+
+// Walks a span of owning tokens
+class SpanTokens {
+public:
+  explicit SpanTokens(std::span<Token> tokens) noexcept : m_tokens(tokens) {}
+
+  TokenType type() const noexcept { return m_tokens.front().type(); }
+  double number() const noexcept { return *m_tokens.front().value(); }
+  Value string() const noexcept {
+    return Value::string(m_tokens.front().interned_lexeme());
+  }
+  // Return true token are available, stays on the last token
+  bool next() noexcept {
+    if (m_tokens.size() <= 1)
+      return false;
+    m_tokens = m_tokens.subspan(1);
+    return true;
+  }
+
+private:
+  std::span<Token> m_tokens;
+};
+
+// Walks the arrays of a TokenBatch, resuming the scanner for the next chunk
+// when it runs out
+class BatchTokens {
+public:
+  explicit BatchTokens(Generator<TokenBatch> &batches)
+      : m_itr(batches.begin()), m_end(batches.end()) {
+    // TODO better error handling
+    if (m_itr == m_end || (*m_itr).size() == 0)
+      abort();
+    m_batch = &*m_itr;
+  }
+
+  TokenType type() const noexcept { return m_batch->types()[m_index]; }
+  double number() const noexcept { return m_batch->numbers()[m_number]; }
+  Value string() const noexcept {
+    return Value::string(m_batch->lexeme(m_index));
+  }
+  // Return true token are available, stays on the last token
+  bool next() noexcept {
+    if (m_index + 1 < m_batch->size()) {
+      m_number += type() == Number;
+      ++m_index;
+      return true;
+    }
+    if (type() == EoF)
+      return false;
+    ++m_itr;
+    // TODO better error handling
+    if (m_itr == m_end || (*m_itr).size() == 0)
+      abort();
+    m_batch = &*m_itr;
+    m_index = 0;
+    m_number = 0;
+    return true;
+  }
+
+private:
+  Generator<TokenBatch>::iterator m_itr;
+  Generator<TokenBatch>::iterator m_end;
+  const TokenBatch *m_batch;
+  size_t m_index = 0;
+  // Index into numbers() of the next Number token
+  size_t m_number = 0;
+};
+// Pops tokens off a ring filled by another thread, waiting when it is empty
+class RingTokens {
+public:
+  RingTokens(TokenRing &ring, std::string_view source)
+      : m_ring(ring), m_source(source) {
+    pop();
+  }
+
+  TokenType type() const noexcept { return m_current.type; }
+  double number() const noexcept {
+    return parse_number(m_current.lexeme(m_source));
+  }
+  Value string() const noexcept {
+    return Value::string(m_current.lexeme(m_source));
+  }
+  // Return true token are available, stays on EoF
+  bool next() noexcept {
+    if (m_current.type == EoF)
+      return false;
+    pop();
+    return true;
+  }
+
+private:
+  void pop() noexcept {
+    std::expected<CompactToken, ScanError> token;
+    // TODO better error handling
+    if (!m_ring.pop(token) || !token)
+      abort();
+    m_current = *token;
+  }
+
+  TokenRing &m_ring;
+  std::string_view m_source;
+  CompactToken m_current{};
+};
+// Follows a tokenize generator, the current token is the one it yielded
+// last and lives in its frame
+template <typename T> class GeneratorTokens {
+public:
+  GeneratorTokens(Generator<std::expected<T, ScanError>> &tokens,
+                  std::string_view source = {})
+      : m_itr(tokens.begin()), m_end(tokens.end()), m_source(source) {
+    require_token();
+  }
+
+  TokenType type() const noexcept {
+    if constexpr (std::same_as<T, Token>)
+      return current().type();
+    else
+      return current().type;
+  }
+  double number() const noexcept {
+    if constexpr (std::same_as<T, Token>) {
+      return *current().value();
+    } else {
+      return parse_number(current().lexeme(m_source));
+    }
+  }
+  Value string() const noexcept {
+    if constexpr (std::same_as<T, Token>)
+      return Value::string(current().interned_lexeme());
+    else
+      return Value::string(current().lexeme(m_source));
+  }
+  // Return true token are available, stays on EoF
+  bool next() noexcept {
+    if (type() == EoF)
+      return false;
+    ++m_itr;
+    require_token();
+    return true;
+  }
+
+private:
+  const T &current() const noexcept { return **m_itr; }
+  void require_token() noexcept {
+    // TODO better error handling
+    if (m_itr == m_end || !*m_itr)
+      abort();
+  }
+
+  typename Generator<std::expected<T, ScanError>>::iterator m_itr;
+  typename Generator<std::expected<T, ScanError>>::iterator m_end;
+  std::string_view m_source;
+};
+} // namespace
+
 Expr Parser::parse(std::span<Token> tokens) {
-  m_token_stream = tokens;
-  m_current_token = m_token_stream.front();
-  return expression();
+  SpanTokens stream(tokens);
+  TreeBuilder builder;
+  return expression(stream, builder);
+}
+
+NodeIndex Parser::parse(std::span<Token> tokens, FlatAst &ast) {
+  SpanTokens stream(tokens);
+  FlatBuilder builder{ast};
+  auto root = expression(stream, builder);
+  ast.set_root(root);
+  return root;
+}
+
+Expr Parser::parse(Generator<TokenBatch> batches) {
+  BatchTokens stream(batches);
+  TreeBuilder builder;
+  return expression(stream, builder);
+}
+
+NodeIndex Parser::parse(Generator<TokenBatch> batches, FlatAst &ast) {
+  BatchTokens stream(batches);
+  FlatBuilder builder{ast};
+  auto root = expression(stream, builder);
+  ast.set_root(root);
+  return root;
 }
 
-constexpr Expr Parser::expression() noexcept {
-  // fmt::print("expression {}\n", m_current_token.type());
+NodeIndex Parser::parse(IncrementalTokens &tokens, FlatAst &ast) {
+  FlatBuilder builder{ast};
+  auto root = expression(tokens, builder);
+  ast.set_root(root);
+  return root;
+}
 
-  return equality();
+Expr Parser::parse(TokenRing &ring, std::string_view source) {
+  RingTokens stream(ring, source);
+  TreeBuilder builder;
+  return expression(stream, builder);
 }
 
-constexpr Expr Parser::equality() noexcept {
-  // fmt::print("equality {}\n", m_current_token.type());
-  auto expr = comparison();
-  using enum TokenType;
-  while (match_any(BangEqual, Equal)) {
-    auto opr = m_current_token;
-    next_token();
-    auto right_expr = comparison();
-    expr = std::make_unique<BinaryExpr>(std::move(expr), opr.type(),
-                                        std::move(right_expr));
-    // if (!next_token())
-    //   break;
-  }
-  return expr;
+NodeIndex Parser::parse(TokenRing &ring, std::string_view source,
+                        FlatAst &ast) {
+  RingTokens stream(ring, source);
+  FlatBuilder builder{ast};
+  auto root = expression(stream, builder);
+  ast.set_root(root);
+  return root;
 }
 
-constexpr Expr Parser::comparison() noexcept {
-  // fmt::print("comparison {}\n", m_current_token.type());
-  auto expr = term();
-  using enum TokenType;
-  while (match_any(Greater, GreaterEqual, Less, LessEqual)) {
-    auto opr = m_current_token;
-    next_token();
-    auto right_expr = term();
-    expr = std::make_unique<BinaryExpr>(std::move(expr), opr.type(),
-                                        std::move(right_expr));
-    // if (!next_token())
-    //   break;
-  }
-  return expr;
+Expr Parser::parse(Generator<std::expected<Token, ScanError>> tokens) {
+  GeneratorTokens<Token> stream(tokens);
+  TreeBuilder builder;
+  return expression(stream, builder);
 }
 
-constexpr Expr Parser::term() noexcept {
-  // fmt::print("term {}\n", m_current_token.type());
-  auto expr = factor();
-  while (match_any(Plus, Minus)) {
-    auto opr = m_current_token;
-    next_token();
-    auto right_expr = factor();
-    expr = std::make_unique<BinaryExpr>(std::move(expr), opr.type(),
-                                        std::move(right_expr));
-    // if (!next_token())
-    //   break;
-  }
-  return expr;
+NodeIndex Parser::parse(Generator<std::expected<Token, ScanError>> tokens,
+                        FlatAst &ast) {
+  GeneratorTokens<Token> stream(tokens);
+  FlatBuilder builder{ast};
+  auto root = expression(stream, builder);
+  ast.set_root(root);
+  return root;
 }
 
-constexpr Expr Parser::factor() noexcept {
-  // fmt::print("factor {}\n", m_current_token.type());
-  auto expr = unary();
-  while (match_any(Slash, Star)) {
-    auto opr = m_current_token;
-    next_token();
-    auto right_expr = unary();
-    expr = std::make_unique<BinaryExpr>(std::move(expr), opr.type(),
-                                        std::move(right_expr));
-    // if (!next_token())
-    //   break;
-  }
-  return expr;
+Expr Parser::parse(Generator<std::expected<CompactToken, ScanError>> tokens,
+                   std::string_view source) {
+  GeneratorTokens<CompactToken> stream(tokens, source);
+  TreeBuilder builder;
+  return expression(stream, builder);
 }
 
-constexpr Expr Parser::unary() noexcept {
-  // TODO Fix this
-  // if (!next_token())
-  //   return std::make_unique<Literal>(0);
-  // fmt::print("unary {}\n", m_current_token.type());
-  if (match_any(Bang, Minus)) {
-    auto opr = m_current_token;
-    auto expr = unary();
-    return std::make_unique<UnaryExpr>(opr.type(), std::move(expr));
-  }
-  return primary();
+NodeIndex
+Parser::parse(Generator<std::expected<CompactToken, ScanError>> tokens,
+              std::string_view source, FlatAst &ast) {
+  GeneratorTokens<CompactToken> stream(tokens, source);
+  FlatBuilder builder{ast};
+  auto root = expression(stream, builder);
+  ast.set_root(root);
+  return root;
 }
 
-constexpr Expr Parser::primary() noexcept {
-  // fmt::print("primary {}\n", m_current_token.type());
+template <TokenStream Tokens, typename Builder>
+constexpr typename Builder::Node
+Parser::expression(Tokens &tokens, Builder &builder) noexcept {
+  JLOX_TRACE_SCOPE("Parser::parse");
+  using Node = typename Builder::Node;
+  using Kind = typename Pending<Node>::Kind;
+  auto &stack = pending<Node>();
+  stack.clear();
+
+  std::uint8_t min_power = lowest_power;
+  Node expr;
+  while (true) {
+    // Prefix operators and open parens, down to a primary
+    if (match_any(tokens, Bang, Minus)) {
+      auto opr = tokens.type();
+      tokens.next();
+      stack.push_back({Kind::Unary, opr, min_power, {}});
+      min_power = prefix_power;
+      continue;
+    }
+    if (!reuse_group(tokens, expr)) {
+      // TODO check this for when should next_token be called
+      if (match_any(tokens, LeftParen) && tokens.next()) {
+        if constexpr (GroupCachingStream<Tokens>)
+          tokens.open_group();
+        stack.push_back({Kind::Group, LeftParen, min_power, {}});
+        min_power = lowest_power;
+        continue;
+      }
+      expr = primary(tokens, builder);
+    }
+
+    // Infix operators binding at least as tight as the operand's context,
+    // finishing pending operations once the next one binds looser
+    while (true) {
+      auto power = binding_power(tokens.type());
+      // 0 for non operators, always below min_power
+      if (power >= min_power) {
+        auto opr = tokens.type();
+        tokens.next();
+        stack.push_back({Kind::Binary, opr, min_power, std::move(expr)});
+        // Left associative, the right operand takes tighter operators only
+        min_power = static_cast<std::uint8_t>(power + 1);
+        break;
+      }
+      if (stack.empty())
+        return expr;
+
+      auto frame = std::move(stack.back());
+      stack.pop_back();
+      min_power = frame.min_power;
+      switch (frame.kind) {
+      case Kind::Unary:
+        expr = builder.unary(frame.opr, std::move(expr));
+        break;
+      case Kind::Binary:
+        expr = builder.binary(std::move(frame.lhs), frame.opr,
+                              std::move(expr));
+        break;
+      case Kind::Group:
+        // TODO better error handling
+        if (!match_any(tokens, RightParen))
+          abort();
+        if constexpr (GroupCachingStream<Tokens>)
+          tokens.close_group(expr);
+        tokens.next();
+        break;
+      }
+    }
+  }
+}
 
-  switch (m_current_token.type()) {
+template <TokenStream Tokens, typename Builder>
+constexpr typename Builder::Node
+Parser::primary(Tokens &tokens, Builder &builder) noexcept {
+  switch (tokens.type()) {
   case Number: {
-    auto matched_token = m_current_token;
-    next_token();
-    return std::make_unique<Literal>(*matched_token.value());
+    // Integral literals are held as integers
+    auto value = Value::number(tokens.number());
+    tokens.next();
+    return builder.literal(value);
   }
   case String: {
-    auto matched_token = m_current_token;
-    next_token();
-    return std::make_unique<Literal>(matched_token.lexeme());
+    auto value = tokens.string();
+    tokens.next();
+    return builder.literal(value);
   }
   case True:
-    next_token();
-    return std::make_unique<Literal>(true);
+    tokens.next();
+    return builder.literal(true);
   case False:
-    next_token();
-    return std::make_unique<Literal>(false);
+    tokens.next();
+    return builder.literal(false);
+  case Nil:
+    tokens.next();
+    return builder.literal(Value());
     // TODO handle these
   case EoF:
-    next_token();
-    return {};
-    // case Nil:
-  }
-
-  // if (match_any(Number, String, True, False, Nil, EoF)) {
-  //   auto matched_token = m_current_token;
-  //   next_token();
-  //   return std::make_unique<Literal>(matched_token);
-  // }
-  // TODO check this for when should next_token be called
-  if (match_any(LeftParen) && next_token()) {
-    auto expr = expression();
-    // TODO better error handling
-    if (!match_any(RightParen))
-      abort();
-    next_token();
-    return expr;
+    tokens.next();
+    return builder.empty();
   }
+  // TODO better error handling
+  return builder.empty();
 }
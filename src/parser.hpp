@@ -1,12 +1,24 @@
 #pragma once
+#include "generator.hpp"
+#include "scanner.hpp"
 #include "token.hpp"
+#include "value.hpp"
+#include <concepts>
+#include <cstdint>
+#include <expected>
+#include <optional>
 #include <fmt/format.h>
 #include <span>
 #include <variant>
+#include <vector>
 
 struct UnaryExpr;
 struct BinaryExpr;
-using Literal = std::variant<std::string, float, bool>;
+class FlatAst;
+class TokenBatch;
+enum class NodeIndex : std::uint32_t;
+// Literal nodes hold the runtime Value they evaluate to
+using Literal = Value;
 
 using UnaryExprPtr = std::unique_ptr<UnaryExpr>;
 using BinaryExprPtr = std::unique_ptr<BinaryExpr>;
@@ -30,81 +42,98 @@ struct UnaryExpr {
       : expr(std::move(expression)), opr(oper) {}
 };
 
-// TODO see if some better repre is possible
-// struct Literal {
-//   TokenType type;
-//   std::optional<ObjectType> value;
-//   Literal(Token t) : type(t.type()), value(t.value()) {}
-//   Literal(TokenType t) : type(t), value(std::nullopt) {}
-//   Literal(float v) : type(TokenType::Number), value(v) {}
-//   Literal(std::string_view v)
-//       : type(TokenType::String), value(std::string(v)) {}
-// };
+// Where Parser reads tokens from. next() returns false, staying on the
+// current token, once there are none left.
+template <typename T>
+concept TokenStream = requires(T &tokens) {
+  { tokens.type() } -> std::same_as<TokenType>;
+  { tokens.number() } -> std::same_as<double>;
+  { tokens.string() } -> std::same_as<Value>;
+  { tokens.next() } -> std::same_as<bool>;
+};
+
+// Streams which remember the subtrees of parenthesized groups from an
+// earlier parse. reuse_group is asked on '(' and either hands back the
+// subtree, having moved past the ')', or nothing. open_group follows '(' and
+// close_group comes on the matching ')' of a group which was parsed.
+template <typename T>
+concept GroupCachingStream =
+    TokenStream<T> && requires(T &tokens, NodeIndex node) {
+      { tokens.reuse_group() } -> std::same_as<std::optional<NodeIndex>>;
+      tokens.open_group();
+      tokens.close_group(node);
+    };
+
+class IncrementalTokens;
 
 class Parser {
 public:
   Expr parse(std::span<Token> tokens);
+  // Appends the tree to ast instead of allocating every node on its own,
+  // returns the root which is also set as the root of ast
+  NodeIndex parse(std::span<Token> tokens, FlatAst &ast);
+  // Reads the tokens straight out of the batches, pulling the next chunk
+  // only once the current one is used up
+  Expr parse(Generator<TokenBatch> batches);
+  NodeIndex parse(Generator<TokenBatch> batches, FlatAst &ast);
+  // Pops tokens off ring as they are needed, for a scanner pushing them on
+  // another thread. source is what the tokens were scanned from.
+  Expr parse(TokenRing &ring, std::string_view source);
+  NodeIndex parse(TokenRing &ring, std::string_view source, FlatAst &ast);
+  // Pulls tokens from the generator as it goes, only the current token is
+  // alive at any time so nothing grows with the size of the input
+  Expr parse(Generator<std::expected<Token, ScanError>> tokens);
+  NodeIndex parse(Generator<std::expected<Token, ScanError>> tokens,
+                  FlatAst &ast);
+  Expr parse(Generator<std::expected<CompactToken, ScanError>> tokens,
+             std::string_view source);
+  NodeIndex parse(Generator<std::expected<CompactToken, ScanError>> tokens,
+                  std::string_view source, FlatAst &ast);
+  // Reparse after an edit, see IncrementalParser
+  NodeIndex parse(IncrementalTokens &tokens, FlatAst &ast);
 
 private:
-  constexpr Expr expression() noexcept;
-  constexpr Expr equality() noexcept;
-  constexpr Expr comparison() noexcept;
-  constexpr Expr term() noexcept;
-  constexpr Expr factor() noexcept;
-  constexpr Expr unary() noexcept;
-  constexpr Expr primary() noexcept;
-
-  inline constexpr bool is_current(TokenType type) noexcept {
-    return m_current_token.type() == type;
+  // Tokens is where tokens are read from, see SpanTokens, BatchTokens,
+  // RingTokens, GeneratorTokens and IncrementalTokens.
+  // Builder decides the AST layout, see TreeBuilder and FlatBuilder
+  //
+  // Precedence climbing over a binding power table, with pending operators
+  // on an explicit stack so nesting depth doesn't use up the native stack
+  template <TokenStream Tokens, typename Builder>
+  constexpr typename Builder::Node expression(Tokens &tokens,
+                                              Builder &builder) noexcept;
+  // Literals, the empty expression otherwise
+  template <TokenStream Tokens, typename Builder>
+  constexpr typename Builder::Node primary(Tokens &tokens,
+                                           Builder &builder) noexcept;
+
+  // Operator of expression waiting for its operand to complete, where the
+  // recursive version would have been waiting for a call to return
+  template <typename Node> struct Pending {
+    enum class Kind : std::uint8_t { Unary, Binary, Group };
+    Kind kind;
+    TokenType opr;
+    // Binding power to go back to once done
+    std::uint8_t min_power;
+    Node lhs;
+  };
+  template <typename Node> std::vector<Pending<Node>> &pending() noexcept {
+    if constexpr (std::same_as<Node, NodeIndex>)
+      return m_flat_pending;
+    else
+      return m_tree_pending;
   }
 
-  template <typename... Ts> bool match_any(Ts... Args) noexcept {
-    bool b = (is_current(Args) || ...);
-    auto s = (fmt::format("{} ", Args) + ...);
-    // fmt::print("Tried to match {} with {} got {}\n", m_current_token.type(),
-    // s, b);
-    return b;
+  template <typename Tokens, typename... Ts>
+  static bool match_any(const Tokens &tokens, Ts... types) noexcept {
+    return ((tokens.type() == types) || ...);
   }
 
-  // Return true token are available
-  bool next_token() noexcept {
-    bool ret = false;
-    if (m_token_stream.size() >= 1) {
-      ret = true;
-      m_token_stream = m_token_stream.subspan(1);
-      m_current_token = m_token_stream.front();
-    }
-    return ret;
-  }
-  Token m_current_token;
-  std::span<Token> m_token_stream;
+  // Kept between parses, so parsing into a reused FlatAst doesn't allocate
+  std::vector<Pending<Expr>> m_tree_pending;
+  std::vector<Pending<NodeIndex>> m_flat_pending;
 };
 
-namespace fmt {
-template <> struct formatter<Literal> {
-
-  constexpr auto parse(format_parse_context &ctx)
-      -> format_parse_context::iterator {
-    auto it = ctx.begin(), end = ctx.end();
-    return it;
-  }
-
-  auto format(const Literal &t, format_context &ctx) const
-      -> format_context::iterator {
-    if (std::holds_alternative<float>(t)) {
-      return fmt::format_to(ctx.out(), "Number");
-    }
-    if (std::holds_alternative<bool>(t)) {
-      return fmt::format_to(ctx.out(), "{}",
-                            std::get<bool>(t) ? "True" : "False");
-    }
-    if (std::holds_alternative<std::string>(t)) {
-      return fmt::format_to(ctx.out(), "String");
-    }
-  }
-};
-} // namespace fmt
-
 namespace fmt {
 template <> struct formatter<Expr> {
 
@@ -0,0 +1,15 @@
+#include "pipeline.hpp"
+#include "flat_ast.hpp"
+#include <thread>
+
+NodeIndex parse_pipelined(Scanner &scanner, Parser &parser,
+                          std::string_view source, FlatAst &ast,
+                          size_t ring_capacity) {
+  TokenRing ring(ring_capacity);
+  std::jthread scanning(
+      [&scanner, &ring, source] { scanner.tokenize_into(source, ring); });
+  auto root = parser.parse(ring, source, ast);
+  // The parser may stop before EoF, don't leave the scanner waiting for room
+  ring.close();
+  return root;
+}
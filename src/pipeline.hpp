@@ -0,0 +1,11 @@
+#pragma once
+#include "parser.hpp"
+#include "scanner.hpp"
+#include <string_view>
+
+// Scans source on a thread of its own while parser builds the tree on the
+// calling thread, the two connected by a TokenRing of ring_capacity tokens.
+// Memory for tokens stays bounded by the ring no matter the size of source.
+NodeIndex parse_pipelined(Scanner &scanner, Parser &parser,
+                          std::string_view source, FlatAst &ast,
+                          size_t ring_capacity = 4096);
@@ -1,7 +1,16 @@
 #include "scanner.hpp"
+#include "dfa_lexer.hpp"
 #include "generator.hpp"
+#include "keywords.hpp"
+#include "number.hpp"
+#include "simd_scan.hpp"
+#include "source_file.hpp"
+#include "thread_pool.hpp"
+#include "token_batch.hpp"
+#include "trace.hpp"
+#include <algorithm>
 #include <cassert>
-#include <charconv>
+#include <cctype>
 #include <concepts>
 #include <coroutine>
 #include <cstdlib>
@@ -9,20 +18,21 @@
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <fstab.h>
-#include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
-#include <unordered_map>
 
 class SourceCode {
 public:
-  using Result = std::expected<Token, ScanError>;
-  constexpr SourceCode(std::string_view src) : m_source_code(src) {}
+  using Result = std::expected<CompactToken, ScanError>;
+  constexpr SourceCode(std::string_view src,
+                       const ScanKernels &kernels = scan_kernels())
+      : m_kernels(kernels), m_source_begin(src.data()), m_source_code(src) {}
 
   // Matches the nth character to be a in src;
   constexpr bool match_next(char a, size_t n) {
-    assert(m_source_code.size() >= n && n != 0);
-    if (a == m_source_code[n - 1]) {
+    assert(n != 0);
+    if (m_source_code.size() >= n && a == m_source_code[n - 1]) {
       consume(n);
       return true;
     }
@@ -46,64 +56,160 @@ public:
     return consume_upto(itr);
   }
 
-  constexpr std::optional<std::string_view>
-  consume_till(std::string_view sentinal) noexcept {
-    assert(!sentinal.empty());
-    auto itr = std::ranges::find(m_source_code, sentinal.front());
-    if (std::distance(itr, m_source_code.end()) < sentinal.size())
-      return std::nullopt; // Error case
-    for (; !sentinal.empty(); sentinal.remove_prefix(1)) {
-      if (*itr == sentinal.front())
-        ++itr;
-      else
+  // Scans the next token, skipping whitespace and comments on the way.
+  // Returns EoF once the source is exhausted.
+  Result next() noexcept {
+    using enum TokenType;
+    while (*this) {
+      const char *start = m_source_code.data();
+      char const c = consume(1).front();
+      switch (c) {
+      case '(':
+        return make_token(LeftParen, start);
+      case ')':
+        return make_token(RightParen, start);
+      case '{':
+        return make_token(LeftBrace, start);
+      case '}':
+        return make_token(RightBrace, start);
+      case ',':
+        return make_token(Comma, start);
+      case '.':
+        return make_token(Dot, start);
+      case '-':
+        return make_token(Minus, start);
+      case '+':
+        return make_token(Plus, start);
+      case ';':
+        return make_token(Semicolon, start);
+      case '*':
+        return make_token(Star, start);
+      case '!': {
+        auto const token_type = match_next('=', 1) ? BangEqual : Bang;
+        return make_token(token_type, start);
+      }
+      case '=': {
+        auto const token_type = match_next('=', 1) ? Equal : Assignment;
+        return make_token(token_type, start);
+      }
+      case '<': {
+        auto const token_type = match_next('=', 1) ? LessEqual : Less;
+        return make_token(token_type, start);
+      }
+      case '>': {
+        auto const token_type = match_next('=', 1) ? GreaterEqual : Greater;
+        return make_token(token_type, start);
+      }
+      case '/': {
+        if (match_next('/', 1)) {
+          // Newline is left for the whitespace case to count
+          consume(m_kernels.find_byte(m_source_code, '\n', m_line));
+        } else if (match_next('*', 1)) {
+          auto end = m_kernels.find_comment_end(m_source_code, m_line);
+          if (end == m_source_code.size()) {
+            consume(end);
+            return std::unexpected(ScanError::NoMultiLineComment);
+          }
+          consume(end + 2);
+        } else {
+          return make_token(Slash, start);
+        }
+        break;
+      }
+      case '"':
+        return get_string();
+      case '\n':
+        ++m_line;
+        [[fallthrough]];
+      case ' ':
+        [[fallthrough]];
+      case '\t':
+        [[fallthrough]];
+      case '\r': {
+        // Only worth a kernel call for a run of whitespace
+        if (*this && is_whitespace(m_source_code.front()))
+          consume(m_kernels.skip_whitespace(m_source_code, m_line));
         break;
+      }
+      default: {
+        if (is_digit(c))
+          return get_number(start);
+        if (std::isalpha(static_cast<unsigned char>(c)))
+          return get_identifier(start);
+        return std::unexpected(ScanError::NoScanableToken);
+      }
+      }
     }
+    return make_token(EoF, m_source_code.data());
+  }
 
-    if (sentinal.empty())
-      return consume_upto(itr);
-    return std::nullopt; // Error
+  explicit constexpr operator bool() const noexcept {
+    return !m_source_code.empty();
   }
 
+  // Restarts scanning at offset into the source, as if line lines had been
+  // seen before it
+  void seek(size_t offset, std::uint32_t line) noexcept {
+    auto size = static_cast<size_t>(m_source_code.data() - m_source_begin) +
+                m_source_code.size();
+    m_source_code = std::string_view(m_source_begin + offset, size - offset);
+    m_line = line;
+  }
+  size_t position() const noexcept {
+    return static_cast<size_t>(m_source_code.data() - m_source_begin);
+  }
+  std::uint32_t line() const noexcept { return m_line; }
+
+private:
   // Caller must have consumed starting quoting
   constexpr Result get_string() noexcept {
-    auto itr = std::ranges::find(m_source_code, '"');
-    auto str = consume_upto(itr);
+    auto str = consume(m_kernels.find_byte(m_source_code, '"', m_line));
+    if (m_source_code.empty())
+      return std::unexpected(ScanError::NoString);
     // To consume remaining quote
     consume(1);
-    if (itr == m_source_code.end())
-      return std::unexpected(ScanError::NoString);
-    return Token(TokenType::String, std::string(str), LineOffset{0});
+    return CompactToken{offset_of(str.data()),
+                        static_cast<std::uint32_t>(str.size()), m_line,
+                        TokenType::String};
   }
 
-  constexpr Token get_number() noexcept {
-    auto itr = std::ranges::find_if(m_source_code, [](char a) noexcept {
-      return !std::isdigit(a) && a != '.';
-    });
-    return Token(TokenType::Number, std::string(consume_upto(itr)),
-                 LineOffset{0});
+  // Caller must have consumed the first digit
+  constexpr CompactToken get_number(const char *start) noexcept {
+    m_source_code.remove_prefix(digit_run(m_source_code));
+    // A fraction needs digits after the dot, "1." is a number and a dot
+    if (m_source_code.size() >= 2 && m_source_code[0] == '.' &&
+        is_digit(m_source_code[1])) {
+      m_source_code.remove_prefix(1);
+      m_source_code.remove_prefix(digit_run(m_source_code));
+    }
+    return make_token(TokenType::Number, start);
   }
 
-  constexpr Token get_identifier(char starting_char) noexcept {
+  // Caller must have consumed the first char
+  constexpr CompactToken get_identifier(const char *start) noexcept {
     // Only alphas are allowed in identifiers;
-    auto indentifier =
-        starting_char + std::string(consume_till(
-                            [](char a) noexcept { return !std::isalpha(a); }));
-    return match_ident_or_keyword(std::move(indentifier));
+    consume_till([](char a) noexcept {
+      return !std::isalpha(static_cast<unsigned char>(a));
+    });
+    auto str = std::string_view(start, m_source_code.data());
+    return make_token(identifier_type(str), start);
   }
 
-  constexpr char peek() const noexcept { return m_source_code.front(); }
+  // Token spanning from start till the current position
+  constexpr CompactToken make_token(TokenType type,
+                                    const char *start) const noexcept {
+    return CompactToken{
+        offset_of(start),
+        static_cast<std::uint32_t>(m_source_code.data() - start), m_line,
+        type};
+  }
 
-  explicit constexpr operator bool() const noexcept {
-    return !m_source_code.empty();
+  constexpr std::uint32_t offset_of(const char *position) const noexcept {
+    return static_cast<std::uint32_t>(position - m_source_begin);
   }
-  size_t s() const noexcept { return m_source_code.size(); }
 
-private:
-  Token match_ident_or_keyword(std::string str) noexcept {
-    auto itr = keyword_map.find(str);
-    if (itr != keyword_map.end())
-      return Token(itr->second, std::move(str), LineOffset{0});
-    return Token(TokenType::Identifier, std::move(str), LineOffset{0});
+  static constexpr bool is_whitespace(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
   }
 
   // Doesn't include the itr in resulting itr;
@@ -115,154 +221,279 @@ private:
         static_cast<size_t>(std::distance(m_source_code.begin(), itr)));
     return str;
   }
-  const std::unordered_map<std::string, TokenType> keyword_map{
-      {"for", TokenType::For},       {"while", TokenType::While},
-      {"if", TokenType::If},         {"else", TokenType::Else},
-      {"class", TokenType::Class},   {"false", TokenType::False},
-      {"true", TokenType::True},     {"nil", TokenType::Nil},
-      {"or", TokenType::Or},         {"and", TokenType::And},
-      {"return", TokenType::Return}, {"super", TokenType::Super},
-      {"this", TokenType::This},     {"var", TokenType::Var},
-      {"def", TokenType::Def}};
+  const ScanKernels &m_kernels;
+  const char *m_source_begin;
   std::string_view m_source_code;
+  std::uint32_t m_line = 1;
 };
 
-void Scanner::scan(std::string_view filepath) {
-  std::ifstream source_file((std::string(filepath)));
+// Materializes the owning Token, interning its lexeme
+static Token to_token(const CompactToken &token, std::string_view src) {
+  auto lexeme = token.lexeme(src);
+  Token result(token.type, lexeme, LineOffset{token.line});
+  if (token.type == TokenType::Number) {
+    result.set_value(parse_number(lexeme));
+  }
+  return result;
+}
+
+ScanStats Scanner::scan(std::string_view filepath) {
+  JLOX_TRACE_SCOPE("Scanner::scan");
+  using Clock = std::chrono::steady_clock;
+  auto load_start = Clock::now();
+  auto source_file = SourceFile::open(filepath);
+  // TODO better error handling
   if (!source_file)
     abort();
-  std::string source((std::istream_iterator<char>(source_file)),
-                     std::istream_iterator<char>());
+  auto source = source_file->contents();
+  auto scan_start = Clock::now();
+
+  ScanStats stats{};
+  m_tokens.clear();
+  for (auto &token : tokenize(source)) {
+    if (token)
+      m_tokens.push_back(*token);
+    else
+      ++stats.errors;
+  }
+  auto scan_end = Clock::now();
+
+  stats.load_time = scan_start - load_start;
+  stats.scan_time = scan_end - scan_start;
+  stats.bytes = source.size();
+  stats.tokens = m_tokens.size();
+  return stats;
 }
 
-Generator<std::expected<Token, ScanError>>
-Scanner::tokenize(std::string_view src) {
-  SourceCode source_code(src);
-  LineOffset line_nr{1};
-  while (source_code) {
-    using enum TokenType;
-    char const c = source_code.consume(1).front();
-    switch (c) {
-    case '(': {
-      co_yield Token(LeftParen, "(", line_nr);
-      break;
-    }
-    case ')': {
-      co_yield Token(RightParen, ")", line_nr);
-      break;
-    }
-    case '{': {
-      co_yield Token(LeftBrace, "{", line_nr);
-      break;
-    }
-    case '}': {
-      co_yield Token(RightBrace, "}", line_nr);
-      break;
-    }
-    case ',': {
-      co_yield Token(Comma, ",", line_nr);
-      break;
-    }
-    case '.': {
-      co_yield Token(Dot, ".", line_nr);
-      break;
-    }
-    case '-': {
-      co_yield Token(Minus, "-", line_nr);
-      break;
-    }
-    case '+': {
-      co_yield Token(Plus, "+", line_nr);
-      break;
-    }
-    case ';': {
-      co_yield Token(Semicolon, ";", line_nr);
-      break;
-    }
-    case '*': {
-      co_yield Token(Star, "*", line_nr);
-      break;
+template <typename Lexer>
+static Generator<std::expected<Token, ScanError>>
+owning_tokens(std::allocator_arg_t, FramePool *, std::string_view src) {
+  JLOX_TRACE_SCOPE("Scanner::tokenize");
+  Lexer lexer(src);
+  while (true) {
+    auto result = lexer.next();
+    if (!result) {
+      co_yield std::unexpected(result.error());
+      continue;
     }
-    case '!': {
-      auto const result = source_code.match_next('=', 1);
-      auto const token_type = result ? TokenType::BangEqual : TokenType::Bang;
-      auto str = result ? "!=" : "!";
-      co_yield Token(token_type, str, line_nr);
+    JLOX_TRACE_COUNT(Tokens, 1);
+    co_yield to_token(*result, src);
+    if (result->type == TokenType::EoF)
       break;
-    }
-    case '=': {
-      auto const result = source_code.match_next('=', 1);
-      auto const token_type = result ? TokenType::Equal : TokenType::Assignment;
-      auto str = result ? "==" : "=";
-      co_yield Token(token_type, str, line_nr);
+  }
+}
+
+template <typename Lexer>
+static Generator<std::expected<CompactToken, ScanError>>
+compact_tokens(std::allocator_arg_t, FramePool *, std::string_view src) {
+  JLOX_TRACE_SCOPE("Scanner::tokenize");
+  Lexer lexer(src);
+  while (true) {
+    auto result = lexer.next();
+    JLOX_TRACE_COUNT(Tokens, result.has_value());
+    co_yield result;
+    if (result && result->type == TokenType::EoF)
       break;
+  }
+}
+
+template <typename Lexer>
+static Generator<TokenBatch> batched_tokens(std::allocator_arg_t, FramePool *,
+                                            std::string_view src,
+                                            TokenBatch &batch) {
+  JLOX_TRACE_SCOPE("Scanner::tokenize");
+  Lexer lexer(src);
+  bool done = false;
+  while (!done) {
+    batch.reset(src);
+    while (!batch.full()) {
+      auto result = lexer.next();
+      if (!result) {
+        batch.push_error(result.error());
+        continue;
+      }
+      batch.push_back(*result);
+      JLOX_TRACE_COUNT(Tokens, 1);
+      if (result->type == TokenType::Number)
+        batch.push_number(parse_number(result->lexeme(src)));
+      if (result->type == TokenType::EoF) {
+        done = true;
+        break;
+      }
     }
-    case '<': {
-      auto const result = source_code.match_next('=', 1);
-      auto const token_type = result ? TokenType::LessEqual : TokenType::Less;
-      auto str = result ? "<=" : "<";
-      co_yield Token(token_type, str, line_nr);
+    co_yield batch;
+  }
+}
+
+Generator<std::expected<Token, ScanError>>
+Scanner::tokenize(std::string_view src, FramePool *frames) {
+  if (m_backend == ScanBackend::Dfa)
+    return owning_tokens<DfaLexer>(std::allocator_arg, frames, src);
+  return owning_tokens<SourceCode>(std::allocator_arg, frames, src);
+}
+
+Generator<std::expected<CompactToken, ScanError>>
+Scanner::tokenize_compact(std::string_view src, FramePool *frames) {
+  if (m_backend == ScanBackend::Dfa)
+    return compact_tokens<DfaLexer>(std::allocator_arg, frames, src);
+  return compact_tokens<SourceCode>(std::allocator_arg, frames, src);
+}
+
+Generator<TokenBatch> Scanner::tokenize_batch(std::string_view src,
+                                              TokenBatch &batch,
+                                              FramePool *frames) {
+  if (m_backend == ScanBackend::Dfa)
+    return batched_tokens<DfaLexer>(std::allocator_arg, frames, src, batch);
+  return batched_tokens<SourceCode>(std::allocator_arg, frames, src, batch);
+}
+
+namespace {
+struct ChunkScan {
+  std::vector<ScanStep> steps;
+  // Where the last step stopped
+  size_t end;
+  std::uint32_t line;
+};
+
+// Scans from offset until a step would start at or after chunk_end, or up to
+// EoF for the last chunk. Tokens may run past chunk_end.
+template <typename Lexer>
+ChunkScan scan_chunk(std::string_view src, size_t offset, size_t chunk_end,
+                     std::uint32_t line, bool last) {
+  Lexer lexer(src);
+  lexer.seek(offset, line);
+  ChunkScan scan;
+  while (last || lexer.position() < chunk_end) {
+    auto start = static_cast<std::uint32_t>(lexer.position());
+    auto start_line = lexer.line();
+    auto result = lexer.next();
+    scan.steps.push_back({start, start_line, result});
+    if (result && result->type == TokenType::EoF)
       break;
-    }
-    case '>': {
-      auto const result = source_code.match_next('=', 1);
-      auto const token_type =
-          result ? TokenType::GreaterEqual : TokenType::Greater;
-      auto str = result ? ">=" : ">";
-      co_yield Token(token_type, str, line_nr);
+  }
+  scan.end = lexer.position();
+  scan.line = lexer.line();
+  return scan;
+}
+
+// Below this chunks cost more to hand out than they save
+constexpr size_t min_parallel_chunk = 256 * 1024;
+} // namespace
+
+template <typename Lexer>
+static std::vector<std::expected<CompactToken, ScanError>>
+parallel_tokens(std::string_view src, ThreadPool &pool, size_t chunks) {
+  // Chunks start after a newline, which usually is between two tokens
+  std::vector<size_t> bounds{0};
+  for (size_t i = 1; i < chunks; ++i) {
+    auto newline = src.find('\n', src.size() / chunks * i);
+    if (newline == std::string_view::npos)
       break;
+    if (newline + 1 > bounds.back() && newline + 1 < src.size())
+      bounds.push_back(newline + 1);
+  }
+  bounds.push_back(src.size());
+
+  // Every chunk pretends to start at line 1 outside of any token
+  auto chunk_count = bounds.size() - 1;
+  std::vector<std::future<ChunkScan>> scans;
+  for (size_t i = 0; i < chunk_count; ++i) {
+    scans.push_back(pool.submit([src, &bounds, i, chunk_count] {
+      return scan_chunk<Lexer>(src, bounds[i], bounds[i + 1], 1,
+                               i + 1 == chunk_count);
+    }));
+  }
+
+  std::vector<std::expected<CompactToken, ScanError>> tokens;
+  size_t position = 0;
+  std::uint32_t line = 1;
+  bool done = false;
+  for (size_t i = 0; i < chunk_count && !done; ++i) {
+    auto scan = scans[i].get();
+    auto step = std::ranges::lower_bound(
+        scan.steps, position, {},
+        [](const ScanStep &s) { return size_t{s.start}; });
+    if (step == scan.steps.end() || step->start != position) {
+      // Guessed wrong, the previous chunk ended inside a token of this one
+      scan = scan_chunk<Lexer>(src, position, bounds[i + 1], line,
+                               i + 1 == chunk_count);
+      step = scan.steps.begin();
     }
-    case '/': {
-      auto const result = source_code.match_next('/', 1);
+    if (step == scan.steps.end())
+      continue;
+    // Lines only differ by the lines before the chunk, unsigned wrap is fine
+    std::uint32_t line_delta = line - step->line;
+    for (; step != scan.steps.end(); ++step) {
+      auto result = step->result;
       if (result) {
-        // I think this should also handle errors
-        source_code.consume_till([](char a) noexcept { return a == '\n'; });
-      } else if (source_code.match_next('*', 1)) {
-        auto result = source_code.consume_till("*/");
-        if (!result) {
-          co_yield std::unexpected(ScanError::NoMultiLineComment);
-        }
-      } else {
-        co_yield Token(TokenType::Slash, "/", line_nr);
+        result->line += line_delta;
+        done = result->type == TokenType::EoF;
       }
-      break;
+      tokens.push_back(result);
     }
-    case '"': {
-      co_yield source_code.get_string();
-      break;
-    }
-    case ' ':
-      [[fallthrough]];
-    case '\t':
-      [[fallthrough]];
-    case '\r':
-      [[fallthrough]];
-    case '\n': {
-      ++line_nr;
+    position = scan.end;
+    line = scan.line + line_delta;
+  }
+  // Chunks after an early EoF still refer to src and bounds
+  for (auto &scan : scans)
+    if (scan.valid())
+      scan.wait();
+  return tokens;
+}
+
+std::vector<std::expected<CompactToken, ScanError>>
+Scanner::tokenize_parallel(std::string_view src, ThreadPool &pool,
+                           size_t chunks) {
+  if (chunks == 0)
+    chunks = std::clamp<size_t>(src.size() / min_parallel_chunk, 1,
+                                pool.size());
+  if (m_backend == ScanBackend::Dfa)
+    return parallel_tokens<DfaLexer>(src, pool, chunks);
+  return parallel_tokens<SourceCode>(src, pool, chunks);
+}
+
+template <typename Lexer>
+static void push_tokens(std::string_view src, TokenRing &ring) {
+  Lexer lexer(src);
+  while (true) {
+    auto result = lexer.next();
+    if (!ring.push(result))
+      return;
+    if (result && result->type == TokenType::EoF)
+      return;
+  }
+}
+
+void Scanner::tokenize_into(std::string_view src, TokenRing &ring) {
+  if (m_backend == ScanBackend::Dfa)
+    push_tokens<DfaLexer>(src, ring);
+  else
+    push_tokens<SourceCode>(src, ring);
+}
+
+template <typename Lexer>
+static Generator<ScanStep> lexer_steps(std::allocator_arg_t, FramePool *,
+                                       std::string_view src, size_t offset,
+                                       std::uint32_t line) {
+  Lexer lexer(src);
+  lexer.seek(offset, line);
+  while (true) {
+    auto start = static_cast<std::uint32_t>(lexer.position());
+    auto start_line = lexer.line();
+    auto result = lexer.next();
+    co_yield ScanStep{start, start_line, result};
+    if (result && result->type == TokenType::EoF)
       break;
-    }
-    default: {
-      if (std::isdigit(c)) {
-        auto token = source_code.get_number();
-        // TODO refactor to make a nice api for getting numbers;
-        std::string s = c + token.lexeme();
-        float value = 0;
-        auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
-        // TODO better error handling
-        if (ec != std::errc())
-          abort();
-        token.set_value(value);
-        co_yield token;
-        break;
-      } else if (std::isalpha(c)) {
-        co_yield source_code.get_identifier(c);
-        break;
-      }
-      co_yield std::unexpected(ScanError::NoScanableToken);
-    }
-    }
   }
-  co_yield Token(TokenType::EoF, "", line_nr);
+}
+
+Generator<ScanStep> Scanner::scan_steps(std::string_view src, size_t offset,
+                                        std::uint32_t line,
+                                        FramePool *frames) {
+  if (m_backend == ScanBackend::Dfa)
+    return lexer_steps<DfaLexer>(std::allocator_arg, frames, src, offset, line);
+  return lexer_steps<SourceCode>(std::allocator_arg, frames, src, offset,
+                                 line);
 }
 
 // void Scanner::run_prompt() {
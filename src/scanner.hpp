@@ -1,5 +1,8 @@
 #pragma once
+#include "frame_pool.hpp"
+#include "spsc_ring.hpp"
 #include "token.hpp"
+#include <chrono>
 #include <expected>
 #include <generator.hpp>
 #include <string_view>
@@ -11,15 +14,78 @@ enum class ScanError {
   NoScanableToken
 };
 
+// Lexer behind Scanner::tokenize, both produce identical tokens
+enum class ScanBackend {
+  Switch, // Hand written, skips whitespace and comments with SIMD kernels
+  Dfa     // Table driven, see DfaLexer
+};
+
+class TokenBatch;
+class ThreadPool;
+// Hands tokens from a scanning thread to a parsing thread
+using TokenRing = SpscRing<std::expected<CompactToken, ScanError>>;
+
+// One call into the lexer, which skips whitespace and comments before
+// producing a token or an error
+struct ScanStep {
+  std::uint32_t start;
+  // Lines seen before start
+  std::uint32_t line;
+  std::expected<CompactToken, ScanError> result;
+};
+
+struct ScanStats {
+  // Time to open and map (or read) the file
+  std::chrono::nanoseconds load_time;
+  // Time spent in tokenize
+  std::chrono::nanoseconds scan_time;
+  size_t bytes;
+  size_t tokens;
+  size_t errors;
+};
+
 class Scanner {
 public:
-  void scan(std::string_view filepath);
+  explicit Scanner(ScanBackend backend = ScanBackend::Switch) noexcept
+      : m_backend(backend) {}
+
+  // Tokenizes the file into tokens(), the file is mapped rather than copied
+  ScanStats scan(std::string_view filepath);
+  const std::vector<Token> &tokens() const noexcept { return m_tokens; }
 
+  // The generator's frame comes from frames when given, which must outlive it
   Generator<std::expected<Token, ScanError>>
-  tokenize(std::string_view source_code);
+  tokenize(std::string_view source_code, FramePool *frames = nullptr);
+  // Same tokens as tokenize, but referring back into source_code instead of
+  // owning their lexemes, so no allocation happens per token.
+  Generator<std::expected<CompactToken, ScanError>>
+  tokenize_compact(std::string_view source_code, FramePool *frames = nullptr);
+  // Scans capacity() tokens at a time into batch, yielding it whenever it is
+  // full and once more with the rest. Resumes once per chunk rather than
+  // once per token.
+  Generator<TokenBatch> tokenize_batch(std::string_view source_code,
+                                       TokenBatch &batch,
+                                       FramePool *frames = nullptr);
+  // Same tokens as tokenize_compact, scanned on pool. Each chunk of the
+  // source is scanned speculatively from its start and joined to the chunk
+  // before at the first token boundary both agree on, being rescanned only
+  // when there is none (say it starts inside a string). 0 chunks picks a
+  // count from the size of the source and of the pool.
+  std::vector<std::expected<CompactToken, ScanError>>
+  tokenize_parallel(std::string_view source_code, ThreadPool &pool,
+                    size_t chunks = 0);
+  // Pushes the tokens of tokenize_compact into ring up to EoF, for a
+  // consumer on another thread. Returns early if ring gets closed.
+  void tokenize_into(std::string_view source_code, TokenRing &ring);
+  // Every lexer call from offset up to EoF, counting lines as if line lines
+  // came before offset. Lets a caller pick scanning up mid source.
+  Generator<ScanStep> scan_steps(std::string_view source_code, size_t offset,
+                                 std::uint32_t line,
+                                 FramePool *frames = nullptr);
   void run_prompt();
 
 private:
   void eval_statement(std::string_view statement);
+  ScanBackend m_backend;
   std::vector<Token> m_tokens;
 };
@@ -0,0 +1,241 @@
+#include "simd_scan.hpp"
+#include <bit>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+constexpr bool is_whitespace(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+size_t find_byte_scalar(std::string_view str, char needle,
+                        std::uint32_t &newlines) noexcept {
+  size_t i = 0;
+  for (; i < str.size() && str[i] != needle; ++i)
+    newlines += str[i] == '\n';
+  return i;
+}
+
+size_t find_comment_end_scalar(std::string_view str,
+                               std::uint32_t &newlines) noexcept {
+  size_t i = 0;
+  for (; i < str.size(); ++i) {
+    if (str[i] == '*' && i + 1 < str.size() && str[i + 1] == '/')
+      return i;
+    newlines += str[i] == '\n';
+  }
+  return i;
+}
+
+size_t skip_whitespace_scalar(std::string_view str,
+                              std::uint32_t &newlines) noexcept {
+  size_t i = 0;
+  for (; i < str.size() && is_whitespace(str[i]); ++i)
+    newlines += str[i] == '\n';
+  return i;
+}
+
+// Newlines in front of bit pos of a movemask
+inline std::uint32_t lines_before(std::uint32_t lines, int pos) noexcept {
+  return static_cast<std::uint32_t>(
+      std::popcount(lines & ((std::uint32_t{1} << pos) - 1)));
+}
+
+#if defined(__x86_64__)
+// SSE2 is part of x86-64, no target attribute needed
+
+inline std::uint32_t mask16(__m128i bytes) noexcept {
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes));
+}
+
+inline __m128i load16(const char *data) noexcept {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+}
+
+size_t find_byte_sse2(std::string_view str, char needle,
+                      std::uint32_t &newlines) noexcept {
+  const auto wanted = _mm_set1_epi8(needle);
+  const auto newline = _mm_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 16 <= str.size(); i += 16) {
+    auto chunk = load16(str.data() + i);
+    auto found = mask16(_mm_cmpeq_epi8(chunk, wanted));
+    auto lines = mask16(_mm_cmpeq_epi8(chunk, newline));
+    if (found) {
+      auto pos = std::countr_zero(found);
+      newlines += lines_before(lines, pos);
+      return i + static_cast<size_t>(pos);
+    }
+    newlines += static_cast<std::uint32_t>(std::popcount(lines));
+  }
+  return i + find_byte_scalar(str.substr(i), needle, newlines);
+}
+
+size_t find_comment_end_sse2(std::string_view str,
+                             std::uint32_t &newlines) noexcept {
+  const auto star = _mm_set1_epi8('*');
+  const auto slash = _mm_set1_epi8('/');
+  const auto newline = _mm_set1_epi8('\n');
+  size_t i = 0;
+  // Second load reads one byte ahead
+  for (; i + 17 <= str.size(); i += 16) {
+    auto chunk = load16(str.data() + i);
+    auto next = load16(str.data() + i + 1);
+    auto found = mask16(_mm_cmpeq_epi8(chunk, star)) &
+                 mask16(_mm_cmpeq_epi8(next, slash));
+    auto lines = mask16(_mm_cmpeq_epi8(chunk, newline));
+    if (found) {
+      auto pos = std::countr_zero(found);
+      newlines += lines_before(lines, pos);
+      return i + static_cast<size_t>(pos);
+    }
+    newlines += static_cast<std::uint32_t>(std::popcount(lines));
+  }
+  return i + find_comment_end_scalar(str.substr(i), newlines);
+}
+
+size_t skip_whitespace_sse2(std::string_view str,
+                            std::uint32_t &newlines) noexcept {
+  const auto space = _mm_set1_epi8(' ');
+  const auto tab = _mm_set1_epi8('\t');
+  const auto carriage = _mm_set1_epi8('\r');
+  const auto newline = _mm_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 16 <= str.size(); i += 16) {
+    auto chunk = load16(str.data() + i);
+    auto line_bytes = _mm_cmpeq_epi8(chunk, newline);
+    auto blank = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, carriage), line_bytes));
+    auto found = ~mask16(blank) & 0xFFFF;
+    auto lines = mask16(line_bytes);
+    if (found) {
+      auto pos = std::countr_zero(found);
+      newlines += lines_before(lines, pos);
+      return i + static_cast<size_t>(pos);
+    }
+    newlines += static_cast<std::uint32_t>(std::popcount(lines));
+  }
+  return i + skip_whitespace_scalar(str.substr(i), newlines);
+}
+
+#define JLOX_AVX2 __attribute__((target("avx2,popcnt,bmi")))
+
+JLOX_AVX2 inline std::uint32_t mask32(__m256i bytes) noexcept {
+  return static_cast<std::uint32_t>(_mm256_movemask_epi8(bytes));
+}
+
+JLOX_AVX2 inline __m256i load32(const char *data) noexcept {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+}
+
+JLOX_AVX2 size_t find_byte_avx2(std::string_view str, char needle,
+                                std::uint32_t &newlines) noexcept {
+  const auto wanted = _mm256_set1_epi8(needle);
+  const auto newline = _mm256_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 32 <= str.size(); i += 32) {
+    auto chunk = load32(str.data() + i);
+    auto found = mask32(_mm256_cmpeq_epi8(chunk, wanted));
+    auto lines = mask32(_mm256_cmpeq_epi8(chunk, newline));
+    if (found) {
+      auto pos = std::countr_zero(found);
+      newlines += lines_before(lines, pos);
+      return i + static_cast<size_t>(pos);
+    }
+    newlines += static_cast<std::uint32_t>(std::popcount(lines));
+  }
+  return i + find_byte_sse2(str.substr(i), needle, newlines);
+}
+
+JLOX_AVX2 size_t find_comment_end_avx2(std::string_view str,
+                                       std::uint32_t &newlines) noexcept {
+  const auto star = _mm256_set1_epi8('*');
+  const auto slash = _mm256_set1_epi8('/');
+  const auto newline = _mm256_set1_epi8('\n');
+  size_t i = 0;
+  // Second load reads one byte ahead
+  for (; i + 33 <= str.size(); i += 32) {
+    auto chunk = load32(str.data() + i);
+    auto next = load32(str.data() + i + 1);
+    auto found = mask32(_mm256_cmpeq_epi8(chunk, star)) &
+                 mask32(_mm256_cmpeq_epi8(next, slash));
+    auto lines = mask32(_mm256_cmpeq_epi8(chunk, newline));
+    if (found) {
+      auto pos = std::countr_zero(found);
+      newlines += lines_before(lines, pos);
+      return i + static_cast<size_t>(pos);
+    }
+    newlines += static_cast<std::uint32_t>(std::popcount(lines));
+  }
+  return i + find_comment_end_sse2(str.substr(i), newlines);
+}
+
+JLOX_AVX2 size_t skip_whitespace_avx2(std::string_view str,
+                                      std::uint32_t &newlines) noexcept {
+  const auto space = _mm256_set1_epi8(' ');
+  const auto tab = _mm256_set1_epi8('\t');
+  const auto carriage = _mm256_set1_epi8('\r');
+  const auto newline = _mm256_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 32 <= str.size(); i += 32) {
+    auto chunk = load32(str.data() + i);
+    auto line_bytes = _mm256_cmpeq_epi8(chunk, newline);
+    auto blank = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space),
+                        _mm256_cmpeq_epi8(chunk, tab)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, carriage), line_bytes));
+    auto found = ~mask32(blank);
+    auto lines = mask32(line_bytes);
+    if (found) {
+      auto pos = std::countr_zero(found);
+      newlines += lines_before(lines, pos);
+      return i + static_cast<size_t>(pos);
+    }
+    newlines += static_cast<std::uint32_t>(std::popcount(lines));
+  }
+  return i + skip_whitespace_sse2(str.substr(i), newlines);
+}
+
+#undef JLOX_AVX2
+#endif
+
+constexpr ScanKernels scalar_kernels{find_byte_scalar, find_comment_end_scalar,
+                                     skip_whitespace_scalar};
+#if defined(__x86_64__)
+constexpr ScanKernels sse2_kernels{find_byte_sse2, find_comment_end_sse2,
+                                   skip_whitespace_sse2};
+constexpr ScanKernels avx2_kernels{find_byte_avx2, find_comment_end_avx2,
+                                   skip_whitespace_avx2};
+#endif
+} // namespace
+
+SimdLevel best_simd_level() noexcept {
+#if defined(__x86_64__)
+  static const SimdLevel level = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") &&
+        __builtin_cpu_supports("bmi"))
+      return SimdLevel::AVX2;
+    return SimdLevel::SSE2;
+  }();
+  return level;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+const ScanKernels &scan_kernels(SimdLevel level) noexcept {
+  switch (level) {
+#if defined(__x86_64__)
+  case SimdLevel::AVX2:
+    return avx2_kernels;
+  case SimdLevel::SSE2:
+    return sse2_kernels;
+#endif
+  default:
+    return scalar_kernels;
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+// Kernels the scanner uses to jump over runs of bytes it doesn't care
+// about. Each returns an index into str (str.size() when nothing was found)
+// and adds the newlines in front of that index to newlines.
+struct ScanKernels {
+  // First occurrence of needle
+  size_t (*find_byte)(std::string_view str, char needle,
+                      std::uint32_t &newlines) noexcept;
+  // Start of the first "*/"
+  size_t (*find_comment_end)(std::string_view str,
+                             std::uint32_t &newlines) noexcept;
+  // First byte which isn't ' ', '\t', '\r' or '\n'
+  size_t (*skip_whitespace)(std::string_view str,
+                            std::uint32_t &newlines) noexcept;
+};
+
+// Widest level the running CPU supports, detected once
+SimdLevel best_simd_level() noexcept;
+// Kernels for level, which must not be above best_simd_level()
+const ScanKernels &scan_kernels(SimdLevel level) noexcept;
+inline const ScanKernels &scan_kernels() noexcept {
+  static const ScanKernels &kernels = scan_kernels(best_simd_level());
+  return kernels;
+}
@@ -0,0 +1,89 @@
+#include "source_file.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+// Closes the descriptor once the file is mapped or read
+struct FileDescriptor {
+  int fd;
+  ~FileDescriptor() {
+    if (fd >= 0)
+      ::close(fd);
+  }
+};
+
+std::error_code last_error() { return {errno, std::system_category()}; }
+} // namespace
+
+std::expected<SourceFile, std::error_code>
+SourceFile::open(std::string_view path) {
+  FileDescriptor file{::open(std::string(path).c_str(), O_RDONLY | O_CLOEXEC)};
+  if (file.fd < 0)
+    return std::unexpected(last_error());
+
+  struct stat info {};
+  if (::fstat(file.fd, &info) != 0)
+    return std::unexpected(last_error());
+
+  SourceFile source;
+  if (S_ISREG(info.st_mode) && info.st_size > 0) {
+    auto size = static_cast<size_t>(info.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+    if (mapping != MAP_FAILED) {
+      // Scanner walks the file front to back exactly once
+      ::madvise(mapping, size, MADV_SEQUENTIAL);
+      source.m_mapping = static_cast<const char *>(mapping);
+      source.m_size = size;
+      return source;
+    }
+  }
+
+  // Pipes and friends, or a file mmap refused
+  constexpr size_t chunk_size = 64 * 1024;
+  if (S_ISREG(info.st_mode))
+    source.m_buffer.reserve(static_cast<size_t>(info.st_size));
+  while (true) {
+    auto old_size = source.m_buffer.size();
+    source.m_buffer.resize(old_size + chunk_size);
+    auto count =
+        ::read(file.fd, source.m_buffer.data() + old_size, chunk_size);
+    if (count < 0 && errno == EINTR) {
+      source.m_buffer.resize(old_size);
+      continue;
+    }
+    if (count < 0)
+      return std::unexpected(last_error());
+    source.m_buffer.resize(old_size + static_cast<size_t>(count));
+    if (count == 0)
+      break;
+  }
+  return source;
+}
+
+SourceFile::SourceFile(SourceFile &&other) noexcept
+    : m_mapping(std::exchange(other.m_mapping, nullptr)),
+      m_size(std::exchange(other.m_size, 0)),
+      m_buffer(std::move(other.m_buffer)) {}
+
+SourceFile &SourceFile::operator=(SourceFile &&other) noexcept {
+  if (this != &other) {
+    unmap();
+    m_mapping = std::exchange(other.m_mapping, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_buffer = std::move(other.m_buffer);
+  }
+  return *this;
+}
+
+SourceFile::~SourceFile() { unmap(); }
+
+void SourceFile::unmap() noexcept {
+  if (m_mapping)
+    ::munmap(const_cast<char *>(m_mapping), m_size);
+  m_mapping = nullptr;
+  m_size = 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <expected>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// Read only contents of a file. Regular files are mapped straight into
+// memory, anything mmap can't handle (pipes, terminals) is read into a
+// buffer instead.
+class SourceFile {
+public:
+  static std::expected<SourceFile, std::error_code> open(std::string_view path);
+
+  SourceFile(const SourceFile &) = delete;
+  SourceFile &operator=(const SourceFile &) = delete;
+  SourceFile(SourceFile &&other) noexcept;
+  SourceFile &operator=(SourceFile &&other) noexcept;
+  ~SourceFile();
+
+  std::string_view contents() const noexcept {
+    return m_mapping ? std::string_view(m_mapping, m_size) : m_buffer;
+  }
+  bool is_mapped() const noexcept { return m_mapping != nullptr; }
+
+private:
+  SourceFile() = default;
+  void unmap() noexcept;
+
+  const char *m_mapping = nullptr;
+  size_t m_size = 0;
+  std::string m_buffer;
+};
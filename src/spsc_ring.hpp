@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Each side keeps a cached copy of the other side's index and only
+// reloads it when the ring looks full (or empty), so the shared cache lines
+// are rarely touched.
+template <typename T> class SpscRing {
+public:
+  // Capacity is rounded up to a power of two
+  explicit SpscRing(size_t capacity)
+      : m_slots(std::bit_ceil(std::max<size_t>(capacity, 2))),
+        m_mask(m_slots.size() - 1) {}
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  size_t capacity() const noexcept { return m_slots.size(); }
+
+  // Producer side, false when full
+  bool try_push(const T &value) noexcept {
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_cached_head == m_slots.size()) {
+      m_cached_head = m_head.load(std::memory_order_acquire);
+      if (tail - m_cached_head == m_slots.size())
+        return false;
+    }
+    m_slots[tail & m_mask] = value;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side, false when empty
+  bool try_pop(T &value) noexcept {
+    auto head = m_head.load(std::memory_order_relaxed);
+    if (head == m_cached_tail) {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (head == m_cached_tail)
+        return false;
+    }
+    value = m_slots[head & m_mask];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Waits for room, false once the ring is closed
+  bool push(const T &value) noexcept {
+    while (!try_push(value)) {
+      if (closed())
+        return false;
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  // Waits for a value, false once the ring is closed and drained
+  bool pop(T &value) noexcept {
+    while (!try_pop(value)) {
+      if (closed())
+        return try_pop(value);
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  // Wakes up a side blocked in push or pop, either side may close
+  void close() noexcept { m_closed.store(true, std::memory_order_release); }
+  bool closed() const noexcept {
+    return m_closed.load(std::memory_order_acquire);
+  }
+
+private:
+  static constexpr size_t cache_line = 64;
+
+  std::vector<T> m_slots;
+  size_t m_mask;
+  std::atomic<bool> m_closed{false};
+  // Consumer
+  alignas(cache_line) std::atomic<size_t> m_head{0};
+  size_t m_cached_tail = 0;
+  // Producer
+  alignas(cache_line) std::atomic<size_t> m_tail{0};
+  size_t m_cached_head = 0;
+};
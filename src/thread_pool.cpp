@@ -0,0 +1,90 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace {
+// Lets submit find the calling worker's own deque
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_worker = 0;
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+  threads = std::max<size_t>(threads, 1);
+  m_deques.reserve(threads);
+  for (size_t i = 0; i < threads; ++i)
+    m_deques.push_back(std::make_unique<JobDeque>());
+  m_workers.reserve(threads);
+  for (size_t i = 0; i < threads; ++i)
+    m_workers.emplace_back([this, i] { work(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_stopping = true;
+  }
+  m_ready.notify_all();
+  // jthread joins on destruction
+  m_workers.clear();
+}
+
+void ThreadPool::push(Job job) {
+  auto index = current_pool == this
+                   ? current_worker
+                   : m_next_deque.fetch_add(1, std::memory_order_relaxed) %
+                         m_deques.size();
+  {
+    // Counted before it is queued so a taker never drops the count below
+    // 0, and under the lock so a worker about to sleep can't miss it
+    std::lock_guard lock(m_mutex);
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+  }
+  {
+    std::lock_guard lock(m_deques[index]->mutex);
+    m_deques[index]->jobs.push_back(std::move(job));
+  }
+  m_ready.notify_one();
+}
+
+bool ThreadPool::take(size_t worker, Job &job) {
+  {
+    auto &own = *m_deques[worker];
+    std::lock_guard lock(own.mutex);
+    if (!own.jobs.empty()) {
+      job = std::move(own.jobs.back());
+      own.jobs.pop_back();
+      m_pending.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  for (size_t i = 1; i < m_deques.size(); ++i) {
+    auto &victim = *m_deques[(worker + i) % m_deques.size()];
+    std::lock_guard lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      m_pending.fetch_sub(1, std::memory_order_relaxed);
+      m_steals.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::work(size_t worker) {
+  current_pool = this;
+  current_worker = worker;
+  while (true) {
+    Job job;
+    if (take(worker, job)) {
+      job();
+      continue;
+    }
+    std::unique_lock lock(m_mutex);
+    m_ready.wait(lock, [this] {
+      return m_stopping || m_pending.load(std::memory_order_relaxed) > 0;
+    });
+    // Stopping and every job taken
+    if (m_pending.load(std::memory_order_relaxed) == 0)
+      return;
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed number of worker threads, each with its own job deque. A worker
+// runs its newest job first and, once out of jobs, steals the oldest job of
+// another worker. Jobs submitted from a worker go to its own deque, jobs
+// from other threads are dealt round robin. Jobs still queued when the pool
+// is destroyed are run before it returns.
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  size_t size() const noexcept { return m_workers.size(); }
+  // Jobs a worker took from another worker's deque
+  size_t steals() const noexcept {
+    return m_steals.load(std::memory_order_relaxed);
+  }
+
+  template <typename F>
+  std::future<std::invoke_result_t<F>> submit(F &&job) {
+    using Result = std::invoke_result_t<F>;
+    // packaged_task is move only, std::function needs copyable
+    auto task =
+        std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+    auto future = task->get_future();
+    push([task] { (*task)(); });
+    return future;
+  }
+
+private:
+  using Job = std::function<void()>;
+  struct JobDeque {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  void push(Job job);
+  bool take(size_t worker, Job &job);
+  void work(size_t worker);
+
+  std::vector<std::unique_ptr<JobDeque>> m_deques;
+  std::atomic<size_t> m_next_deque = 0;
+  std::atomic<size_t> m_steals = 0;
+  // Jobs queued and not yet taken, sleeping workers wait on it
+  std::atomic<size_t> m_pending = 0;
+  std::mutex m_mutex;
+  std::condition_variable m_ready;
+  bool m_stopping = false;
+  std::vector<std::jthread> m_workers;
+};
@@ -1,8 +1,11 @@
 #pragma once
+#include "interner.hpp"
 #include <cstddef>
+#include <cstdint>
 #include <fmt/format.h>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 enum class TokenType {
   // Sinle char
@@ -61,27 +64,46 @@ class Token {
 public:
   // using TokenValue =
   //     std::variant<std::monostate, float, int, std::string, bool>;
-  using TokenValue = std::optional<float>;
+  using TokenValue = std::optional<double>;
 
   Token() {}
-  Token(TokenType type, std::string lexeme, LineOffset line_nr,
+  // Lexeme is interned in the global StringInterner
+  Token(TokenType type, std::string_view lexeme, LineOffset line_nr,
         ColumnOffset col_nr = ColumnOffset{0})
       : m_line_nr(line_nr), m_col_nr(col_nr), m_type(type),
-        m_lexeme_value(lexeme), m_value(std::nullopt) {}
+        m_lexeme_value(StringInterner::global().intern(lexeme)),
+        m_value(std::nullopt) {}
 
   TokenType type() const noexcept { return m_type; }
-  std::string lexeme() const noexcept { return m_lexeme_value; }
-  void set_value(float v) noexcept { m_value = v; }
+  std::string_view lexeme() const noexcept { return m_lexeme_value.view(); }
+  InternedString interned_lexeme() const noexcept { return m_lexeme_value; }
+  void set_value(double v) noexcept { m_value = v; }
   auto value() const noexcept { return m_value; }
 
 private:
   LineOffset m_line_nr;
   ColumnOffset m_col_nr;
   TokenType m_type;
-  std::string m_lexeme_value;
+  InternedString m_lexeme_value;
   TokenValue m_value;
 };
 
+// Token which refers back into the scanned source instead of owning its
+// lexeme, scanning into these never allocates. Number values are resolved
+// from the lexeme when needed.
+struct CompactToken {
+  std::uint32_t offset;
+  std::uint32_t length;
+  std::uint32_t line;
+  TokenType type;
+
+  constexpr std::string_view lexeme(std::string_view source) const noexcept {
+    return source.substr(offset, length);
+  }
+};
+
+static_assert(sizeof(CompactToken) <= 16);
+
 namespace fmt {
 template <> struct formatter<TokenType> {
 
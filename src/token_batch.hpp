@@ -0,0 +1,69 @@
+#pragma once
+#include "scanner.hpp"
+#include "token.hpp"
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Chunk of tokens in structure of arrays layout, filled by
+// Scanner::tokenize_batch. Each field has its own array so walking the
+// types touches nothing else. Number values go in a side table holding one
+// entry per Number token, in order. Lexemes refer back into source().
+class TokenBatch {
+public:
+  explicit TokenBatch(size_t capacity = 1024) : m_capacity(capacity) {
+    assert(capacity != 0);
+    m_types.reserve(capacity);
+    m_offsets.reserve(capacity);
+    m_lengths.reserve(capacity);
+    m_lines.reserve(capacity);
+  }
+
+  // Empties the batch for tokens scanned from source
+  void reset(std::string_view source) noexcept {
+    m_source = source;
+    m_types.clear();
+    m_offsets.clear();
+    m_lengths.clear();
+    m_lines.clear();
+    m_numbers.clear();
+    m_errors.clear();
+  }
+  void push_back(const CompactToken &token) {
+    m_types.push_back(token.type);
+    m_offsets.push_back(token.offset);
+    m_lengths.push_back(token.length);
+    m_lines.push_back(token.line);
+  }
+  void push_number(double value) { m_numbers.push_back(value); }
+  void push_error(ScanError error) { m_errors.push_back(error); }
+
+  size_t size() const noexcept { return m_types.size(); }
+  size_t capacity() const noexcept { return m_capacity; }
+  bool full() const noexcept { return size() >= m_capacity; }
+
+  std::span<const TokenType> types() const noexcept { return m_types; }
+  std::span<const std::uint32_t> offsets() const noexcept { return m_offsets; }
+  std::span<const std::uint32_t> lengths() const noexcept { return m_lengths; }
+  std::span<const std::uint32_t> lines() const noexcept { return m_lines; }
+  std::span<const double> numbers() const noexcept { return m_numbers; }
+  // Errors met while filling this batch, the tokens around them are kept
+  std::span<const ScanError> errors() const noexcept { return m_errors; }
+
+  std::string_view source() const noexcept { return m_source; }
+  std::string_view lexeme(size_t index) const noexcept {
+    return m_source.substr(m_offsets[index], m_lengths[index]);
+  }
+
+private:
+  size_t m_capacity;
+  std::string_view m_source;
+  std::vector<TokenType> m_types;
+  std::vector<std::uint32_t> m_offsets;
+  std::vector<std::uint32_t> m_lengths;
+  std::vector<std::uint32_t> m_lines;
+  std::vector<double> m_numbers;
+  std::vector<ScanError> m_errors;
+};
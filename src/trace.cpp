@@ -0,0 +1,147 @@
+#include "trace.hpp"
+#include <fmt/format.h>
+
+#ifdef JLOX_TRACE
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+std::string_view trace::counter_name(Counter counter) noexcept {
+  switch (counter) {
+  case Counter::Tokens:
+    return "tokens";
+  case Counter::Nodes:
+    return "nodes";
+  case Counter::LexemeBytes:
+    return "lexeme_bytes";
+  case Counter::Evaluations:
+    return "evaluations";
+  }
+  return "unknown";
+}
+
+#ifdef JLOX_TRACE
+namespace {
+struct Event {
+  const char *name;
+  std::int64_t start_ns;
+  std::int64_t end_ns;
+};
+
+// Written by its own thread only, counters are atomic just so that
+// counter() may read them while the thread runs
+struct ThreadTrace {
+  std::uint32_t tid;
+  std::array<std::atomic<std::uint64_t>, trace::counter_count> counters{};
+  std::vector<Event> events;
+};
+
+struct Registry {
+  std::mutex mutex;
+  // Outlive their threads, so a trace can be dumped after they exit
+  std::vector<std::shared_ptr<ThreadTrace>> threads;
+  std::chrono::steady_clock::time_point epoch =
+      std::chrono::steady_clock::now();
+};
+
+Registry &registry() {
+  static Registry registry;
+  return registry;
+}
+
+ThreadTrace &this_thread() {
+  thread_local std::shared_ptr<ThreadTrace> trace = [] {
+    auto &reg = registry();
+    std::lock_guard lock(reg.mutex);
+    auto created = std::make_shared<ThreadTrace>();
+    created->tid = static_cast<std::uint32_t>(reg.threads.size() + 1);
+    reg.threads.push_back(created);
+    return created;
+  }();
+  return *trace;
+}
+} // namespace
+
+void trace::add(Counter counter, std::uint64_t count) noexcept {
+  // Single writer, a plain load and store is enough and cheaper than an RMW
+  auto &value = this_thread().counters[static_cast<size_t>(counter)];
+  value.store(value.load(std::memory_order_relaxed) + count,
+              std::memory_order_relaxed);
+}
+
+void trace::record(const char *name, std::int64_t start_ns,
+                   std::int64_t end_ns) noexcept {
+  this_thread().events.push_back({name, start_ns, end_ns});
+}
+
+std::int64_t trace::now_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - registry().epoch)
+      .count();
+}
+
+std::uint64_t trace::counter(Counter counter) noexcept {
+  auto &reg = registry();
+  std::lock_guard lock(reg.mutex);
+  std::uint64_t sum = 0;
+  for (const auto &thread : reg.threads)
+    sum += thread->counters[static_cast<size_t>(counter)].load(
+        std::memory_order_relaxed);
+  return sum;
+}
+
+std::string trace::chrome_trace_json() {
+  auto &reg = registry();
+  std::lock_guard lock(reg.mutex);
+  std::string json = "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+  std::int64_t last_ns = 0;
+  const char *separator = "\n";
+  for (const auto &thread : reg.threads) {
+    for (const auto &event : thread->events) {
+      // Chrome wants microseconds
+      json += fmt::format("{}{{\"name\": \"{}\", \"ph\": \"X\", \"ts\": {:.3f}, "
+                          "\"dur\": {:.3f}, \"pid\": 1, \"tid\": {}}}",
+                          separator, event.name,
+                          static_cast<double>(event.start_ns) / 1e3,
+                          static_cast<double>(event.end_ns - event.start_ns) / 1e3,
+                          thread->tid);
+      separator = ",\n";
+      last_ns = std::max(last_ns, event.end_ns);
+    }
+  }
+  json += fmt::format("{}{{\"name\": \"counters\", \"ph\": \"C\", \"ts\": "
+                      "{:.3f}, \"pid\": 1, \"args\": {{",
+                      separator, static_cast<double>(last_ns) / 1e3);
+  for (size_t i = 0; i < counter_count; ++i) {
+    auto which = static_cast<Counter>(i);
+    std::uint64_t sum = 0;
+    for (const auto &thread : reg.threads)
+      sum += thread->counters[i].load(std::memory_order_relaxed);
+    json += fmt::format("{}\"{}\": {}", i ? ", " : "", counter_name(which), sum);
+  }
+  json += "}}\n]}\n";
+  return json;
+}
+
+void trace::reset() noexcept {
+  auto &reg = registry();
+  std::lock_guard lock(reg.mutex);
+  for (auto &thread : reg.threads) {
+    thread->events.clear();
+    for (auto &value : thread->counters)
+      value.store(0, std::memory_order_relaxed);
+  }
+}
+#else
+std::uint64_t trace::counter(Counter) noexcept { return 0; }
+
+std::string trace::chrome_trace_json() {
+  return "{\"displayTimeUnit\": \"ns\", \"traceEvents\": []}\n";
+}
+
+void trace::reset() noexcept {}
+#endif
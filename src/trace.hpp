@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Timers and counters around the pipeline stages. They are only compiled
+// in when JLOX_TRACE is defined, otherwise the macros expand to nothing and
+// the functions below report an empty trace.
+//
+//   JLOX_TRACE_SCOPE("Parser::parse");  // times the enclosing scope
+//   JLOX_TRACE_COUNT(Tokens, 1);        // bumps trace::Counter::Tokens
+namespace trace {
+
+enum class Counter : std::uint8_t {
+  Tokens,      // Tokens the scanner produced
+  Nodes,       // AST nodes the parser allocated
+  LexemeBytes, // Lexeme bytes copied into the StringInterner
+  Evaluations, // Nodes the interpreter evaluated
+};
+inline constexpr size_t counter_count = 4;
+
+std::string_view counter_name(Counter counter) noexcept;
+
+// Sum over every thread
+std::uint64_t counter(Counter counter) noexcept;
+// Scopes and counters recorded so far in Chrome's trace_event format, load
+// it in chrome://tracing or Perfetto. Threads still recording must be done
+// before this is called.
+std::string chrome_trace_json();
+// Drops everything recorded so far, under the same condition
+void reset() noexcept;
+
+#ifdef JLOX_TRACE
+void add(Counter counter, std::uint64_t count) noexcept;
+// Records [start_ns, end_ns) on the calling thread
+void record(const char *name, std::int64_t start_ns,
+            std::int64_t end_ns) noexcept;
+std::int64_t now_ns() noexcept;
+
+class Scope {
+public:
+  explicit Scope(const char *name) noexcept : m_name(name), m_start(now_ns()) {}
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+  ~Scope() { record(m_name, m_start, now_ns()); }
+
+private:
+  const char *m_name;
+  std::int64_t m_start;
+};
+#endif
+} // namespace trace
+
+#ifdef JLOX_TRACE
+#define JLOX_TRACE_CONCAT_(a, b) a##b
+#define JLOX_TRACE_CONCAT(a, b) JLOX_TRACE_CONCAT_(a, b)
+#define JLOX_TRACE_SCOPE(name)                                                 \
+  ::trace::Scope JLOX_TRACE_CONCAT(jlox_trace_scope_, __LINE__) { name }
+#define JLOX_TRACE_COUNT(counter, count)                                       \
+  ::trace::add(::trace::Counter::counter, count)
+#else
+#define JLOX_TRACE_SCOPE(name) static_cast<void>(0)
+#define JLOX_TRACE_COUNT(counter, count) static_cast<void>(0)
+#endif
@@ -0,0 +1,5 @@
+#include "value.hpp"
+
+Value Value::string(std::string_view str) {
+  return string(StringInterner::global().intern(str));
+}
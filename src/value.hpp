@@ -0,0 +1,220 @@
+#pragma once
+#include <bit>
+#include <cassert>
+#include <compare>
+#include "interner.hpp"
+#include <cstdint>
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+
+enum class ValueType { String, Number, Bool, Nil };
+
+// Runtime value packed in a single 64 bit word. Numbers are stored as the
+// raw bits of a double, every other type hides in the payload of a quiet
+// NaN:
+//
+//   nil     0x7ffc000000000001
+//   false   0x7ffc000000000002
+//   true    0x7ffc000000000003
+//   integer 0x7ffd000000000000 | low 48 bits of the two's complement
+//   string  0xfffc000000000000 | pointer to the string
+//
+// Integers are numbers too, they only let integer arithmetic skip the
+// conversions to double and stay exact. Whether a number is held as one is
+// never observable.
+//
+// Strings are owned by the global StringInterner, so a Value is trivially
+// copyable, never owns anything and equal strings have equal bits.
+class Value {
+public:
+  constexpr Value() noexcept : m_bits(nil_bits) {}
+  constexpr Value(double number) noexcept
+      : m_bits(std::bit_cast<std::uint64_t>(number)) {
+    // A NaN which looks like one of our tags is turned into a plain NaN
+    if ((m_bits & qnan) == qnan)
+      m_bits = canonical_nan;
+  }
+  constexpr Value(bool boolean) noexcept
+      : m_bits(boolean ? true_bits : false_bits) {}
+  // Would otherwise silently convert to bool, use Value::string
+  Value(const char *) = delete;
+
+  // Held as an integer when it fits in 48 bits, as a double otherwise
+  static constexpr Value integer(std::int64_t number) noexcept {
+    if (number < -int_limit || number >= int_limit)
+      return Value(static_cast<double>(number));
+    return Value(int_tag | (static_cast<std::uint64_t>(number) & int_payload),
+                 nullptr);
+  }
+  // Integral doubles are held as integers, except for -0.0 which behaves
+  // differently from 0 (1 / -0.0 is -inf)
+  static constexpr Value number(double number) noexcept {
+    if (number >= -static_cast<double>(int_limit) &&
+        number < static_cast<double>(int_limit)) {
+      auto integral = static_cast<std::int64_t>(number);
+      if (static_cast<double>(integral) == number &&
+          std::bit_cast<std::uint64_t>(number) != sign_bit)
+        return integer(integral);
+    }
+    return Value(number);
+  }
+
+  // Interns str in the global interner
+  static Value string(std::string_view str);
+  static Value string(InternedString str) noexcept {
+    return Value(sign_bit | qnan | reinterpret_cast<std::uintptr_t>(str.get()),
+                 nullptr);
+  }
+
+  constexpr bool is_number() const noexcept {
+    return (m_bits & qnan) != qnan || is_int();
+  }
+  constexpr bool is_int() const noexcept {
+    return (m_bits & tag_mask) == int_tag;
+  }
+  constexpr bool is_bool() const noexcept {
+    return (m_bits | 1) == true_bits;
+  }
+  constexpr bool is_nil() const noexcept { return m_bits == nil_bits; }
+  constexpr bool is_string() const noexcept {
+    return (m_bits & (sign_bit | qnan)) == (sign_bit | qnan);
+  }
+
+  constexpr ValueType type() const noexcept {
+    if (is_number())
+      return ValueType::Number;
+    if (is_string())
+      return ValueType::String;
+    if (is_bool())
+      return ValueType::Bool;
+    return ValueType::Nil;
+  }
+
+  constexpr double as_number() const noexcept {
+    assert(is_number());
+    if (is_int())
+      return static_cast<double>(as_int());
+    return std::bit_cast<double>(m_bits);
+  }
+  constexpr std::int64_t as_int() const noexcept {
+    assert(is_int());
+    // Sign extends the 48 bit payload
+    return static_cast<std::int64_t>(m_bits << 16) >> 16;
+  }
+  constexpr bool as_bool() const noexcept {
+    assert(is_bool());
+    return m_bits == true_bits;
+  }
+  std::string_view as_string() const noexcept {
+    assert(is_string());
+    return *reinterpret_cast<const std::string *>(m_bits &
+                                                  ~(sign_bit | qnan));
+  }
+
+  // Numbers compare as doubles (so NaN != NaN), everything else by bits
+  // which for interned strings is their identity.
+  friend bool operator==(Value left, Value right) noexcept {
+    if (left.is_int() && right.is_int())
+      return left.m_bits == right.m_bits;
+    if (left.is_number() && right.is_number())
+      return left.as_number() == right.as_number();
+    return left.m_bits == right.m_bits;
+  }
+  // Values of different types are ordered by ValueType
+  friend std::partial_ordering operator<=>(Value left, Value right) noexcept {
+    if (left.is_int() && right.is_int())
+      return left.as_int() <=> right.as_int();
+    if (left.is_number() && right.is_number())
+      return left.as_number() <=> right.as_number();
+    if (left.is_string() && right.is_string())
+      return left.as_string() <=> right.as_string();
+    if (left.type() != right.type())
+      return left.type() <=> right.type();
+    return left.m_bits <=> right.m_bits;
+  }
+
+private:
+  static constexpr std::uint64_t sign_bit = 0x8000000000000000;
+  static constexpr std::uint64_t qnan = 0x7ffc000000000000;
+  static constexpr std::uint64_t canonical_nan = 0x7ff8000000000000;
+  static constexpr std::uint64_t nil_bits = qnan | 1;
+  static constexpr std::uint64_t false_bits = qnan | 2;
+  static constexpr std::uint64_t true_bits = qnan | 3;
+  static constexpr std::uint64_t tag_mask = 0xffff000000000000;
+  static constexpr std::uint64_t int_tag = qnan | 0x0001000000000000;
+  static constexpr std::uint64_t int_payload = 0x0000ffffffffffff;
+  static constexpr std::int64_t int_limit = std::int64_t{1} << 47;
+
+  explicit constexpr Value(std::uint64_t bits, std::nullptr_t) noexcept
+      : m_bits(bits) {}
+
+  std::uint64_t m_bits;
+};
+
+static_assert(sizeof(Value) == 8);
+
+// Arithmetic on numbers, which the callers have checked both operands are.
+// Integers stay integers while the exact result fits one and are promoted
+// to double otherwise, so results always match plain double arithmetic.
+inline Value add_numbers(Value left, Value right) noexcept {
+  // 48 bit operands can't overflow 64 bits, integer() range checks the sum
+  if (left.is_int() && right.is_int())
+    return Value::integer(left.as_int() + right.as_int());
+  return left.as_number() + right.as_number();
+}
+
+inline Value subtract_numbers(Value left, Value right) noexcept {
+  if (left.is_int() && right.is_int())
+    return Value::integer(left.as_int() - right.as_int());
+  return left.as_number() - right.as_number();
+}
+
+inline Value multiply_numbers(Value left, Value right) noexcept {
+  std::int64_t product = 0;
+  if (left.is_int() && right.is_int() &&
+      !__builtin_mul_overflow(left.as_int(), right.as_int(), &product)) {
+    // As a double 0 * -5 is -0.0
+    if (product == 0 && (left.as_int() < 0 || right.as_int() < 0))
+      return -0.0;
+    return Value::integer(product);
+  }
+  return left.as_number() * right.as_number();
+}
+
+inline Value divide_numbers(Value left, Value right) noexcept {
+  return left.as_number() / right.as_number();
+}
+
+inline Value negate_number(Value operand) noexcept {
+  if (operand.is_int() && operand.as_int() != 0)
+    return Value::integer(-operand.as_int());
+  return -1 * operand.as_number();
+}
+
+namespace fmt {
+template <> struct formatter<Value> {
+
+  constexpr auto parse(format_parse_context &ctx)
+      -> format_parse_context::iterator {
+    auto it = ctx.begin(), end = ctx.end();
+    return it;
+  }
+
+  auto format(const Value &t, format_context &ctx) const
+      -> format_context::iterator {
+    switch (t.type()) {
+    case ValueType::Number:
+      return fmt::format_to(ctx.out(), "Number");
+    case ValueType::Bool:
+      return fmt::format_to(ctx.out(), "{}", t.as_bool() ? "True" : "False");
+    case ValueType::String:
+      return fmt::format_to(ctx.out(), "String");
+    case ValueType::Nil:
+      return fmt::format_to(ctx.out(), "Nil");
+    default:
+      abort();
+    }
+  }
+};
+} // namespace fmt
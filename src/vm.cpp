@@ -0,0 +1,120 @@
+#include "vm.hpp"
+#include <cassert>
+#include <cstdlib>
+
+// TODO better error handling
+static inline void require_numbers(Value left, Value right) noexcept {
+  if (!left.is_number() || !right.is_number())
+    abort();
+}
+
+Value VM::run(const Chunk &chunk) noexcept {
+  if (m_stack.size() < chunk.max_stack_depth)
+    m_stack.resize(chunk.max_stack_depth);
+  const std::uint8_t *ip = chunk.code.data();
+  const Value *constants = chunk.constants.data();
+  // Points one past the top of the stack
+  Value *top = m_stack.data();
+
+  for (;;) {
+    switch (static_cast<OpCode>(*ip++)) {
+    case OpCode::Constant: {
+      *top++ = constants[*ip++];
+      break;
+    }
+    case OpCode::ConstantLong: {
+      size_t index = ip[0] | (size_t{ip[1]} << 8) | (size_t{ip[2]} << 16);
+      ip += 3;
+      *top++ = constants[index];
+      break;
+    }
+    case OpCode::True: {
+      *top++ = true;
+      break;
+    }
+    case OpCode::False: {
+      *top++ = false;
+      break;
+    }
+    case OpCode::Nil: {
+      *top++ = Value();
+      break;
+    }
+    case OpCode::Negate: {
+      // TODO better error handling
+      if (!top[-1].is_number())
+        abort();
+      top[-1] = negate_number(top[-1]);
+      break;
+    }
+    case OpCode::Not: {
+      // TODO better error handling
+      if (!top[-1].is_bool())
+        abort();
+      top[-1] = !top[-1].as_bool();
+      break;
+    }
+    case OpCode::Add: {
+      --top;
+      require_numbers(top[-1], *top);
+      top[-1] = add_numbers(top[-1], *top);
+      break;
+    }
+    case OpCode::Subtract: {
+      --top;
+      require_numbers(top[-1], *top);
+      top[-1] = subtract_numbers(top[-1], *top);
+      break;
+    }
+    case OpCode::Multiply: {
+      --top;
+      require_numbers(top[-1], *top);
+      top[-1] = multiply_numbers(top[-1], *top);
+      break;
+    }
+    case OpCode::Divide: {
+      --top;
+      require_numbers(top[-1], *top);
+      top[-1] = divide_numbers(top[-1], *top);
+      break;
+    }
+    case OpCode::Equal: {
+      --top;
+      top[-1] = top[-1] == *top;
+      break;
+    }
+    case OpCode::NotEqual: {
+      --top;
+      top[-1] = top[-1] != *top;
+      break;
+    }
+    case OpCode::Greater: {
+      --top;
+      top[-1] = top[-1] > *top;
+      break;
+    }
+    case OpCode::GreaterEqual: {
+      --top;
+      top[-1] = top[-1] >= *top;
+      break;
+    }
+    case OpCode::Less: {
+      --top;
+      top[-1] = top[-1] < *top;
+      break;
+    }
+    case OpCode::LessEqual: {
+      --top;
+      top[-1] = top[-1] <= *top;
+      break;
+    }
+    case OpCode::Return: {
+      assert(top == m_stack.data() + 1);
+      return top[-1];
+    }
+    default:
+      // TODO better error handling
+      abort();
+    }
+  }
+}
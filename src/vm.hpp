@@ -0,0 +1,14 @@
+#pragma once
+#include "bytecode.hpp"
+#include <vector>
+
+// Stack machine running Chunks produced by Compiler. Gives the same results
+// as Interpreter, but walks a flat byte array instead of the Expr tree.
+class VM {
+public:
+  Value run(const Chunk &chunk) noexcept;
+
+private:
+  // Kept between runs so evaluating a chunk repeatedly doesn't reallocate
+  std::vector<Value> m_stack;
+};
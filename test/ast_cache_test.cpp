@@ -0,0 +1,114 @@
+#include <ast_cache.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <filesystem>
+#include <flat_ast.hpp>
+#include <fstream>
+#include <interpreter.hpp>
+#include <string>
+#include <unistd.h>
+
+namespace {
+// Fresh directory per test, removed again when done
+struct TemporaryDirectory {
+  std::filesystem::path path;
+  explicit TemporaryDirectory(std::string_view name)
+      : path(std::filesystem::temp_directory_path() /
+             fmt::format("jlox-{}-{}", name, getpid())) {
+    std::filesystem::remove_all(path);
+  }
+  ~TemporaryDirectory() { std::filesystem::remove_all(path); }
+};
+
+FlatAst parse(std::string_view src) {
+  FlatAst ast;
+  Parser().parse(Scanner().tokenize_compact(src), src, ast);
+  return ast;
+}
+} // namespace
+
+TEST_CASE("AstCache.round_trip", "[AstCache]") {
+  auto src = GENERATE(as<std::string>{}, "1 + 2 * 3", "(1 + 2) * -3 >= 9",
+                      R"("a" == "a" == !(nil == "bc"))", "!true == false",
+                      "");
+  INFO(src);
+  auto ast = parse(src);
+  auto hash = source_hash(src);
+  auto image = serialize_ast(ast, hash);
+
+  FlatAst loaded;
+  REQUIRE(deserialize_ast(image, hash, loaded));
+  REQUIRE(loaded.size() == ast.size());
+  REQUIRE(loaded.root() == ast.root());
+  if (ast.root() == invalid_node)
+    return;
+  REQUIRE(fmt::format("{}", loaded) == fmt::format("{}", ast));
+  REQUIRE(Interpreter()(loaded) == Interpreter()(ast));
+}
+
+TEST_CASE("AstCache.rejects_bad_images", "[AstCache]") {
+  std::string src = "(1 + 2) * \"x\" == nil";
+  auto ast = parse(src);
+  auto hash = source_hash(src);
+  auto image = serialize_ast(ast, hash);
+  FlatAst loaded;
+  REQUIRE_FALSE(deserialize_ast(image, hash + 1, loaded));
+  REQUIRE_FALSE(deserialize_ast(image.substr(0, image.size() - 1), hash,
+                                loaded));
+  REQUIRE_FALSE(deserialize_ast("", hash, loaded));
+
+  // Node 0 is the literal 1, pointing it at itself as a unary makes a cycle
+  auto corrupt = image;
+  FlatNode node{NodeKind::Unary, TokenType::Minus, 0, 0};
+  std::memcpy(corrupt.data() + 40, &node, sizeof(node));
+  REQUIRE_FALSE(deserialize_ast(corrupt, hash, loaded));
+  REQUIRE(loaded.size() == 0);
+}
+
+TEST_CASE("AstCache.hit_and_miss", "[AstCache]") {
+  TemporaryDirectory directory("ast-cache");
+  std::string src = "(1 + 2) * -3 >= 9 == (\"s\" == \"s\")";
+  auto expected = parse(src);
+  {
+    AstCache cache(directory.path);
+    FlatAst ast;
+    cache.load(src, ast);
+    REQUIRE(fmt::format("{}", ast) == fmt::format("{}", expected));
+    REQUIRE(cache.stats().misses == 1);
+    REQUIRE(cache.stats().write_failures == 0);
+    REQUIRE(std::filesystem::exists(cache.entry_path(source_hash(src))));
+  }
+  // Another run, as a new process would
+  AstCache cache(directory.path);
+  FlatAst ast;
+  cache.load(src, ast);
+  REQUIRE(cache.stats().hits == 1);
+  REQUIRE(fmt::format("{}", ast) == fmt::format("{}", expected));
+  REQUIRE(Interpreter()(ast) == Interpreter()(expected));
+
+  // A broken entry is a miss and gets replaced
+  std::ofstream(cache.entry_path(source_hash(src)), std::ios::trunc) << "junk";
+  cache.load(src, ast);
+  REQUIRE(cache.stats().misses == 1);
+  cache.load(src, ast);
+  REQUIRE(cache.stats().hits == 2);
+  REQUIRE(fmt::format("{}", ast) == fmt::format("{}", expected));
+}
+
+TEST_CASE("AstCache.benchmark", "[.][AstCache][Benchmark]") {
+  TemporaryDirectory directory("ast-cache-bench");
+  std::string src = "1";
+  for (int i = 0; i < 200000; ++i)
+    src += fmt::format(" + {} * ({} - 2) == \"s{}\"", i % 10, i % 7, i % 13);
+  Scanner scanner;
+  Parser parser;
+  FlatAst ast;
+  BENCHMARK("cold: tokenize + parse") {
+    ast.reset();
+    return parser.parse(scanner.tokenize_compact(src), src, ast);
+  };
+  AstCache cache(directory.path);
+  cache.load(src, ast);
+  BENCHMARK("warm: load from cache") { return cache.load(src, ast); };
+}
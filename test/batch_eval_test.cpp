@@ -0,0 +1,103 @@
+#include <atomic>
+#include <batch_eval.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <flat_ast.hpp>
+#include <interpreter.hpp>
+#include <scanner.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+std::string nth_expression(size_t i) {
+  return fmt::format("({} + {}) * -{} >= {}", i, i % 7, i % 3, i / 2);
+}
+} // namespace
+
+TEST_CASE("ThreadPool.work_stealing", "[BatchEval]") {
+  ThreadPool pool(4);
+  std::atomic<size_t> ran = 0;
+  // Every job lands on the deque of the worker submitting them, the others
+  // only get to them by stealing
+  auto spawned = pool.submit([&pool, &ran] {
+    std::vector<std::future<void>> jobs;
+    for (int i = 0; i < 64; ++i)
+      jobs.push_back(pool.submit([&ran] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ++ran;
+      }));
+    return jobs;
+  });
+  for (auto &job : spawned.get())
+    job.get();
+  REQUIRE(ran == 64);
+  REQUIRE(pool.steals() > 0);
+}
+
+TEST_CASE("ThreadPool.drains_on_destroy", "[BatchEval]") {
+  std::atomic<size_t> ran = 0;
+  {
+    ThreadPool pool(2);
+    for (int i = 0; i < 1000; ++i)
+      pool.submit([&ran] { ++ran; });
+  }
+  REQUIRE(ran == 1000);
+}
+
+TEST_CASE("BatchEval.in_order", "[BatchEval]") {
+  Scanner scanner;
+  Parser parser;
+  std::vector<Expr> exprs;
+  FlatAst ast;
+  std::vector<NodeIndex> roots;
+  for (size_t i = 0; i < 1000; ++i) {
+    auto src = nth_expression(i);
+    exprs.push_back(parser.parse(scanner.tokenize(src)));
+    roots.push_back(parser.parse(scanner.tokenize_compact(src), src, ast));
+  }
+
+  ThreadPool pool(4);
+  auto results = evaluate_batch(pool, exprs);
+  auto flat_results = evaluate_batch(pool, ast, roots);
+  REQUIRE(results.size() == exprs.size());
+  REQUIRE(flat_results.size() == roots.size());
+  for (size_t i = 0; i < exprs.size(); ++i) {
+    auto expected = std::visit(Interpreter(), exprs[i]);
+    REQUIRE(results[i] == expected);
+    REQUIRE(flat_results[i] == expected);
+  }
+  REQUIRE(evaluate_batch(pool, std::span<const Expr>()).empty());
+}
+
+TEST_CASE("BatchEval.shared_expr", "[BatchEval]") {
+  Scanner scanner;
+  Parser parser;
+  auto expr = parser.parse(scanner.tokenize("\"a\" == \"a\" == !(1 < 2)"));
+  ThreadPool pool(3);
+  auto results = evaluate_batch(pool, expr, 777);
+  REQUIRE(results.size() == 777);
+  for (auto result : results)
+    REQUIRE(result == Value(false));
+}
+
+TEST_CASE("BatchEval.benchmark", "[.][BatchEval][Benchmark]") {
+  Scanner scanner;
+  Parser parser;
+  std::vector<Expr> exprs;
+  for (size_t i = 0; i < 20000; ++i) {
+    std::string src = nth_expression(i);
+    for (size_t j = 0; j < 20; ++j)
+      src += fmt::format(" == {} < {}", i + j, j);
+    exprs.push_back(parser.parse(scanner.tokenize(src)));
+  }
+  BENCHMARK("single thread") {
+    std::vector<Value> results;
+    results.reserve(exprs.size());
+    for (const auto &expr : exprs)
+      results.push_back(std::visit(Interpreter(), expr));
+    return results;
+  };
+  ThreadPool pool;
+  BENCHMARK("thread pool") { return evaluate_batch(pool, exprs); };
+}
@@ -0,0 +1,61 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <closure.hpp>
+#include <interpreter.hpp>
+#include <parser.hpp>
+#include <scanner.hpp>
+#include <vm.hpp>
+
+namespace {
+Expr parse_source(std::string_view src) {
+  Scanner scanner;
+  Parser parser;
+  return parser.parse(scanner.tokenize(src));
+}
+} // namespace
+
+TEST_CASE("ClosureCompiler", "[Closure]") {
+  SECTION("Same result as Interpreter") {
+    auto src = GENERATE(as<std::string>{}, "34 >2", "34 >=2", "34 <2",
+                        "34 <=2", "34==2", "34==34", "34!=2", "34!=34",
+                        R"=("This is test"== "This is test")=",
+                        R"=("abc" < "abd")=", R"=("b" >= "abd")=",
+                        "54>2!=5", "34+28-12/3", "34+(28-12)/3", "-4*(2+-3)",
+                        "!true", "!(1 < 2)", "true == !false", "nil == nil",
+                        "((((1+2)*3)-4)/5)", "1 / 0", "0 / 0 == 0 / 0", "7");
+    auto expr = parse_source(src);
+    auto compiled = ClosureCompiler().compile(expr);
+    INFO(src);
+    REQUIRE(compiled() == std::visit(Interpreter(), expr));
+  }
+
+  SECTION("Every node compiled") {
+    auto expr = parse_source("1+(2+(3+-4))");
+    auto compiled = ClosureCompiler().compile(expr);
+    REQUIRE(compiled.size() == 8);
+    REQUIRE(compiled().as_number() == 2);
+  }
+
+  SECTION("Outlives the tree and compiler") {
+    CompiledExpr compiled;
+    {
+      ClosureCompiler compiler;
+      compiled = compiler.compile(parse_source("(1 + 2) * 3 == 9"));
+    }
+    REQUIRE(compiled().as_bool());
+    auto moved = std::move(compiled);
+    REQUIRE(moved().as_bool());
+  }
+}
+
+TEST_CASE("ClosureCompiler.benchmark", "[.][Closure][Benchmark]") {
+  auto expr = parse_source("(1+2)*3-4/5 > 2 == !(3 <= 4*(5-6)) != false");
+  auto compiled = ClosureCompiler().compile(expr);
+  auto chunk = Compiler().compile(expr);
+  VM vm;
+
+  BENCHMARK("Interpreter") { return std::visit(Interpreter(), expr); };
+  BENCHMARK("Closures") { return compiled(); };
+  BENCHMARK("VM") { return vm.run(chunk); };
+}
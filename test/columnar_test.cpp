@@ -0,0 +1,128 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <cmath>
+#include <columnar.hpp>
+#include <interpreter.hpp>
+#include <parser.hpp>
+#include <random>
+#include <scanner.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+Expr parse_source(std::string_view src) {
+  Scanner scanner;
+  Parser parser;
+  return parser.parse(scanner.tokenize(src));
+}
+
+std::string literal(double value) {
+  if (std::isnan(value))
+    return "(0 / 0)";
+  return value < 0 || std::signbit(value) ? fmt::format("(-{})", -value)
+                                          : fmt::format("{}", value);
+}
+
+// src with the column names replaced by the row's values
+std::string row_source(std::string src, double a, double b) {
+  for (auto [name, value] : {std::pair{"\"a\"", a}, std::pair{"\"b\"", b}})
+    for (auto at = src.find(name); at != std::string::npos;
+         at = src.find(name))
+      src.replace(at, 3, literal(value));
+  return src;
+}
+
+bool same(Value left, Value right) {
+  if (left.is_number() && right.is_number() && std::isnan(left.as_number()))
+    return std::isnan(right.as_number());
+  return left == right &&
+         std::signbit(left.is_number() ? left.as_number() : 0) ==
+             std::signbit(right.is_number() ? right.as_number() : 0);
+}
+
+constexpr std::string_view names[] = {"a", "b"};
+} // namespace
+
+TEST_CASE("Columnar.same_as_interpreter", "[Columnar]") {
+  std::mt19937_64 random(25);
+  std::uniform_real_distribution<double> real(-100, 100);
+  std::uniform_int_distribution<int> small(-3, 3);
+  // Rows of a partial last block and a partial last mask word
+  std::vector<double> a(2500), b(2500);
+  for (size_t i = 0; i < a.size(); ++i) {
+    a[i] = i % 3 ? real(random) : small(random);
+    b[i] = i % 5 ? std::round(real(random)) : small(random);
+  }
+  a[7] = NAN;
+  b[8] = -0.0;
+  a[9] = b[9];
+
+  auto src = GENERATE(as<std::string>{}, R"("a")", R"("a" + "b" * 2)",
+                      R"("a" - 3)", R"(3 - "a")", R"(10 / "b")", R"(-"a")",
+                      R"("a" * 0)", R"("a" < "b")", R"(2 >= "a")",
+                      R"("a" == "b")", R"("a" != "b")", R"(!("a" > 0))",
+                      R"(("a" > 0) == ("b" > 0))", R"(("a" > 0) != true)",
+                      R"(false == ("a" <= "b"))", R"("a" == nil)",
+                      R"("a" == "x")", R"(("a" + 1) * ("b" - 1) / 2 > "a")",
+                      R"(("a" < 1) == 1)", "1 + 2", "1 < 2");
+  INFO(src);
+  auto compiled = ColumnarCompiler().compile(parse_source(src), names);
+  std::span<const double> columns[] = {a, b};
+  auto result = compiled(columns);
+  REQUIRE(result.rows == a.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    auto row = row_source(src, a[i], b[i]);
+    INFO(row);
+    REQUIRE(same(result.value(i), std::visit(Interpreter(), parse_source(row))));
+  }
+  if (result.kind == ColumnarResult::Kind::Mask)
+    REQUIRE(result.mask.back() >> (a.size() % 64) == 0);
+}
+
+TEST_CASE("Columnar.compile", "[Columnar]") {
+  SECTION("Constants are folded") {
+    auto compiled =
+        ColumnarCompiler().compile(parse_source(R"("a" * (2 + 3) - -1)"), names);
+    REQUIRE(compiled.size() == 2);
+  }
+
+  SECTION("Comparing with a boolean reuses the mask") {
+    auto compiled = ColumnarCompiler().compile(
+        parse_source(R"(("a" < "b") == true)"), names);
+    REQUIRE(compiled.size() == 1);
+  }
+
+  SECTION("Empty columns") {
+    auto compiled =
+        ColumnarCompiler().compile(parse_source(R"("a" > "b")"), names);
+    std::span<const double> columns[] = {{}, {}};
+    auto result = compiled(columns);
+    REQUIRE(result.rows == 0);
+    REQUIRE(result.mask.empty());
+  }
+}
+
+TEST_CASE("Columnar.benchmark", "[.][Columnar][Benchmark]") {
+  constexpr size_t rows = 1 << 20;
+  std::mt19937_64 random(25);
+  std::uniform_real_distribution<double> real(-100, 100);
+  std::vector<double> a(rows), b(rows);
+  for (size_t i = 0; i < rows; ++i) {
+    a[i] = real(random);
+    b[i] = real(random);
+  }
+  std::span<const double> columns[] = {a, b};
+  auto src = R"(("a" + 1) * ("b" - 1) / 2 > "a" * 3)";
+  auto compiled = ColumnarCompiler().compile(parse_source(src), names);
+  // The same tree with values in place of the columns, walked once per row
+  auto expr = parse_source(row_source(src, 1.5, 2.5));
+
+  BENCHMARK("Interpreter per row") {
+    size_t matches = 0;
+    for (size_t i = 0; i < rows; ++i)
+      matches += std::visit(Interpreter(), expr).as_bool();
+    return matches;
+  };
+  BENCHMARK("ColumnarExpr") { return compiled(columns).mask.size(); };
+}
@@ -0,0 +1,92 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <expected>
+#include <random>
+#include <scanner.hpp>
+#include <string>
+#include <vector>
+
+static std::vector<std::expected<CompactToken, ScanError>>
+tokens_of(ScanBackend backend, std::string_view src) {
+  Scanner scanner(backend);
+  std::vector<std::expected<CompactToken, ScanError>> tokens;
+  for (auto &token : scanner.tokenize_compact(src))
+    tokens.push_back(token);
+  return tokens;
+}
+
+static void require_same_tokens(std::string_view src) {
+  auto expected = tokens_of(ScanBackend::Switch, src);
+  auto actual = tokens_of(ScanBackend::Dfa, src);
+  INFO(src);
+  REQUIRE(actual.size() == expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    INFO(i);
+    REQUIRE(actual[i].has_value() == expected[i].has_value());
+    if (!expected[i]) {
+      REQUIRE(actual[i].error() == expected[i].error());
+      continue;
+    }
+    REQUIRE(actual[i]->type == expected[i]->type);
+    REQUIRE(actual[i]->offset == expected[i]->offset);
+    REQUIRE(actual[i]->length == expected[i]->length);
+    REQUIRE(actual[i]->line == expected[i]->line);
+  }
+}
+
+TEST_CASE("DfaLexer.corpus", "[Scanner]") {
+  auto src = GENERATE(
+      "", "   \n\t\r ", "(){},.-+;*/", "! != = == < <= > >=", "!\n=\n<\n>\n/",
+      R"=(() == != > < for if else var while  <= "Man this is working" 343)=",
+      R"=(print "Hello";)=", "def fib(n){\n if (n < 3){ return 1; }\n"
+                             "  return fib(n-1) + fib(n-2);\n}\n",
+      "var x = 12.5.3; // trailing comment\nx", "// comment at the end",
+      "/* block\n * comment **/ and /*/ still comment */ or",
+      "/* never closed\n", "\"never closed\n", "\"multi\nline\" nil",
+      "@ # $ 12abc abc12 _x", "classy this thus superb returns", "1.");
+  require_same_tokens(src);
+}
+
+TEST_CASE("DfaLexer.random", "[Scanner]") {
+  static constexpr std::string_view alphabet = "ab01 \n\t\"/*!=<>.(){},;+-#";
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+  for (int round = 0; round < 500; ++round) {
+    std::string src;
+    for (int i = 0; i < 40; ++i)
+      src += alphabet[pick(rng)];
+    require_same_tokens(src);
+  }
+}
+
+TEST_CASE("DfaLexer.tokenize", "[Scanner]") {
+  Scanner scanner(ScanBackend::Dfa);
+  std::vector<TokenType> types{TokenType::Var,        TokenType::Identifier,
+                               TokenType::Assignment, TokenType::String,
+                               TokenType::Semicolon,  TokenType::EoF};
+  size_t index = 0;
+  for (auto token : scanner.tokenize(R"(var greeting = "hi";)")) {
+    REQUIRE(token);
+    REQUIRE(token->type() == types[index++]);
+    if (token->type() == TokenType::String)
+      REQUIRE(token->lexeme() == "hi");
+  }
+  REQUIRE(index == types.size());
+}
+
+TEST_CASE("DfaLexer.benchmark", "[.][Scanner][Benchmark]") {
+  std::string src;
+  for (int i = 0; i < 20000; ++i)
+    src += "def fib(n) {\n  if (n <= 2) return 1; // base case\n"
+           "  /* recurse */ return fib(n - 1) + fib(n - 2) != \"x\";\n}\n";
+  auto count = [&src](ScanBackend backend) {
+    Scanner scanner(backend);
+    size_t tokens = 0;
+    for (auto &token : scanner.tokenize_compact(src))
+      tokens += token.has_value();
+    return tokens;
+  };
+  BENCHMARK("switch") { return count(ScanBackend::Switch); };
+  BENCHMARK("dfa") { return count(ScanBackend::Dfa); };
+}
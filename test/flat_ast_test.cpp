@@ -0,0 +1,111 @@
+#include <atomic>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <cstdlib>
+#include <flat_ast.hpp>
+#include <fmt/core.h>
+#include <interpreter.hpp>
+#include <new>
+#include <parser.hpp>
+#include <scanner.hpp>
+
+// Counts every global allocation so parser layouts can be compared
+static std::atomic<size_t> allocation_count{0};
+
+void *operator new(std::size_t size) {
+  ++allocation_count;
+  if (auto *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  ++allocation_count;
+  return std::malloc(size ? size : 1);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {
+  return operator new(size, tag);
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+static std::vector<Token> scan_source(std::string_view src) {
+  Scanner scanner;
+  std::vector<Token> tokens;
+  for (auto i : scanner.tokenize(src)) {
+    tokens.push_back(i.value());
+  }
+  return tokens;
+}
+
+static std::string generate_source(size_t terms) {
+  std::string src = "1";
+  for (size_t i = 1; i < terms; ++i)
+    src += fmt::format(" {} ({} - {})", i % 2 ? '+' : '*', i, i % 7);
+  return src;
+}
+
+TEST_CASE("FlatAst", "[Parser]") {
+  SECTION("Same tree as Expr") {
+    auto src = GENERATE(as<std::string>{}, "34 >2", "54>2!=5", "34+28-12/3",
+                        "34+(28-12)/3", "-4*(2+-3)", "!(1 < 2) == false",
+                        R"=("This is test"== "This is test")=");
+    auto tokens = scan_source(src);
+    Parser parser;
+    auto expr = parser.parse(tokens);
+    FlatAst ast;
+    parser.parse(tokens, ast);
+    INFO(src);
+    REQUIRE(fmt::format("{}", expr) == fmt::format("{}", ast));
+    REQUIRE(std::visit(Interpreter(), expr) == Interpreter()(ast));
+  }
+
+  SECTION("Reset reuses the arena") {
+    auto tokens = scan_source(generate_source(64));
+    Parser parser;
+    FlatAst ast;
+    parser.parse(tokens, ast);
+    auto nodes = ast.size();
+    auto result = Interpreter()(ast);
+
+    ast.reset();
+    REQUIRE(ast.size() == 0);
+    auto before = allocation_count.load();
+    parser.parse(tokens, ast);
+    REQUIRE(allocation_count.load() == before);
+    REQUIRE(ast.size() == nodes);
+    REQUIRE(Interpreter()(ast) == result);
+  }
+}
+
+TEST_CASE("FlatAst.benchmark", "[.][Parser][Benchmark]") {
+  auto src = generate_source(4096);
+  auto tokens = scan_source(src);
+  Parser parser;
+
+  {
+    auto before = allocation_count.load();
+    auto expr = parser.parse(tokens);
+    auto tree_allocations = allocation_count.load() - before;
+
+    FlatAst ast;
+    parser.parse(tokens, ast);
+    ast.reset();
+    before = allocation_count.load();
+    parser.parse(tokens, ast);
+    auto flat_allocations = allocation_count.load() - before;
+    fmt::print("{} tokens: unique_ptr tree {} allocations, flat ast {} "
+               "allocations\n",
+               tokens.size(), tree_allocations, flat_allocations);
+  }
+
+  BENCHMARK("unique_ptr tree") { return parser.parse(tokens); };
+  FlatAst ast;
+  BENCHMARK("flat ast") {
+    ast.reset();
+    return parser.parse(tokens, ast);
+  };
+}
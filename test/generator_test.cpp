@@ -0,0 +1,114 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <generator.hpp>
+#include <memory>
+#include <scanner.hpp>
+#include <stdexcept>
+
+namespace {
+struct CopyCounter {
+  explicit CopyCounter(int v) : value(v) {}
+  CopyCounter(const CopyCounter &other) : value(other.value) { ++copies; }
+  CopyCounter(CopyCounter &&other) noexcept : value(other.value) { ++moves; }
+  int value;
+  static inline int copies = 0;
+  static inline int moves = 0;
+};
+
+Generator<CopyCounter> counters(int n) {
+  for (int i = 0; i < n; ++i) {
+    CopyCounter counter(i);
+    co_yield counter;
+    co_yield CopyCounter(-i);
+  }
+}
+
+Generator<std::unique_ptr<int>> move_only() {
+  co_yield std::make_unique<int>(7);
+}
+
+Generator<int> throwing() {
+  co_yield 1;
+  throw std::runtime_error("generator failed");
+}
+
+Generator<int> pooled(std::allocator_arg_t, FramePool *, int n) {
+  for (int i = 0; i < n; ++i)
+    co_yield i;
+}
+} // namespace
+
+TEST_CASE("Generator.no_copies", "[Generator]") {
+  CopyCounter::copies = CopyCounter::moves = 0;
+  int sum = 0;
+  for (auto &counter : counters(10))
+    sum += counter.value;
+  REQUIRE(sum == 0);
+  REQUIRE(CopyCounter::copies == 0);
+  REQUIRE(CopyCounter::moves == 0);
+
+  // Consumers may move the yielded object out
+  for (auto &ptr : move_only()) {
+    auto owned = std::move(ptr);
+    REQUIRE(*owned == 7);
+  }
+}
+
+TEST_CASE("Generator.exceptions", "[Generator]") {
+  auto gen = throwing();
+  auto itr = gen.begin();
+  REQUIRE(*itr == 1);
+  REQUIRE_THROWS_AS(++itr, std::runtime_error);
+}
+
+TEST_CASE("Generator.frame_pool", "[Generator]") {
+  FramePool pool;
+  for (int round = 0; round < 100; ++round) {
+    int sum = 0;
+    for (auto i : pooled(std::allocator_arg, &pool, 4))
+      sum += i;
+    REQUIRE(sum == 6);
+  }
+  REQUIRE(pool.heap_allocations() == 1);
+
+  // Without a pool frames come from the global heap
+  int sum = 0;
+  for (auto i : pooled(std::allocator_arg, nullptr, 3))
+    sum += i;
+  REQUIRE(sum == 3);
+}
+
+TEST_CASE("Generator.frame_pool_scanner", "[Generator]") {
+  FramePool pool;
+  Scanner scanner;
+  for (int round = 0; round < 100; ++round) {
+    size_t tokens = 0;
+    for (auto &token : scanner.tokenize_compact("var x = 1 + 2;", &pool))
+      tokens += token.has_value();
+    for (auto &token : scanner.tokenize("x * 3;", &pool))
+      tokens += token.has_value();
+    REQUIRE(tokens == 13);
+  }
+  // One frame for each generator kind, both recycled every round
+  REQUIRE(pool.heap_allocations() <= 2);
+}
+
+TEST_CASE("Generator.benchmark", "[.][Generator][Benchmark]") {
+  Scanner scanner;
+  FramePool pool;
+  static constexpr std::string_view line = "print 1 + 2 * (3 - 4);";
+  BENCHMARK("small scans, global heap") {
+    size_t tokens = 0;
+    for (int i = 0; i < 1000; ++i)
+      for (auto &token : scanner.tokenize_compact(line))
+        tokens += token.has_value();
+    return tokens;
+  };
+  BENCHMARK("small scans, frame pool") {
+    size_t tokens = 0;
+    for (int i = 0; i < 1000; ++i)
+      for (auto &token : scanner.tokenize_compact(line, &pool))
+        tokens += token.has_value();
+    return tokens;
+  };
+}
@@ -0,0 +1,142 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <flat_ast.hpp>
+#include <incremental.hpp>
+#include <interpreter.hpp>
+#include <cctype>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+void require_fresh(const IncrementalParser &incremental) {
+  auto src = incremental.source();
+  INFO(src);
+  Scanner scanner;
+  std::vector<std::expected<CompactToken, ScanError>> expected;
+  for (auto &token : scanner.tokenize_compact(src))
+    expected.push_back(token);
+  auto tokens = incremental.tokens();
+  REQUIRE(tokens.size() == expected.size());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    REQUIRE(tokens[i].has_value() == expected[i].has_value());
+    if (!expected[i])
+      continue;
+    REQUIRE(tokens[i]->type == expected[i]->type);
+    REQUIRE(tokens[i]->offset == expected[i]->offset);
+    REQUIRE(tokens[i]->length == expected[i]->length);
+    REQUIRE(tokens[i]->line == expected[i]->line);
+  }
+
+  FlatAst ast;
+  Parser().parse(scanner.tokenize_compact(src), src, ast);
+  REQUIRE((incremental.root() == invalid_node) == (ast.root() == invalid_node));
+  if (ast.root() == invalid_node)
+    return;
+  REQUIRE(fmt::format("{}", incremental.ast()) == fmt::format("{}", ast));
+  // Formatted, random edits may well divide 0 by 0
+  REQUIRE(fmt::format("{}", Interpreter()(incremental.ast())) ==
+          fmt::format("{}", Interpreter()(ast)));
+}
+} // namespace
+
+TEST_CASE("IncrementalParser.edits", "[Incremental]") {
+  auto backend = GENERATE(ScanBackend::Switch, ScanBackend::Dfa);
+  IncrementalParser parser("(1 + 2) * (3 - (4 / 2))\n== 3", backend);
+  require_fresh(parser);
+  // Grow a number, the token before the edit has to be rescanned
+  parser.edit({1, 0, "0"});
+  require_fresh(parser);
+  // New line shifts the lines of everything after it
+  parser.edit({0, 0, "\n\n"});
+  require_fresh(parser);
+  // Replace a group with a literal
+  parser.edit({parser.source().find("(4"), 7, "8"});
+  require_fresh(parser);
+  // Remove everything
+  parser.edit({0, parser.source().size(), ""});
+  require_fresh(parser);
+  parser.edit({0, 0, "!(\"a\" == \"a\") == (-1 < 2)"});
+  require_fresh(parser);
+}
+
+TEST_CASE("IncrementalParser.random_edits", "[Incremental]") {
+  static constexpr std::string_view numbers[] = {"7", "42", "3.5", "(3)",
+                                                 "(1 + (2 * 3))", "-(4)"};
+  static constexpr std::string_view operators[] = {"+", "-", "*", "/"};
+  static constexpr std::string_view blanks[] = {" ", "\n", "\n\n  "};
+  std::mt19937 random(17);
+  std::string src = "1";
+  for (int i = 0; i < 30; ++i)
+    src = fmt::format("({} + {})", src, i % 10);
+  IncrementalParser parser(src);
+  // Every edit keeps the source valid, the parse aborts otherwise
+  auto find = [&](std::string_view set) {
+    std::uniform_int_distribution<size_t> pick(0, parser.source().size() - 1);
+    auto at = parser.source().find_first_of(set, pick(random));
+    return at == std::string_view::npos ? parser.source().find_first_of(set)
+                                        : at;
+  };
+  for (int i = 0; i < 400; ++i) {
+    std::uniform_int_distribution<size_t> choice(0, 2);
+    auto source = parser.source();
+    switch (choice(random)) {
+    case 0: {
+      // Replace a whole number
+      auto at = find("0123456789");
+      while (at > 0 && (std::isdigit(source[at - 1]) || source[at - 1] == '.'))
+        --at;
+      auto end = source.find_first_not_of("0123456789.", at);
+      std::uniform_int_distribution<size_t> pick(0, std::size(numbers) - 1);
+      parser.edit({at, end - at, numbers[pick(random)]});
+      break;
+    }
+    case 1: {
+      std::uniform_int_distribution<size_t> pick(0, std::size(operators) - 1);
+      parser.edit({find("+*/"), 1, operators[pick(random)]});
+      break;
+    }
+    default: {
+      std::uniform_int_distribution<size_t> pick(0, std::size(blanks) - 1);
+      parser.edit({find(" \n"), 0, blanks[pick(random)]});
+      break;
+    }
+    }
+    require_fresh(parser);
+  }
+}
+
+TEST_CASE("IncrementalParser.reuses_groups", "[Incremental]") {
+  std::string src = "0";
+  for (int i = 0; i < 1000; ++i)
+    src += fmt::format(" + ({} * ({} - 1))", i % 10, i % 7);
+  IncrementalParser parser(src);
+  auto full_size = parser.ast().size();
+  auto stats = parser.edit({src.size() - 4, 1, "9"});
+  require_fresh(parser);
+  REQUIRE(stats.tokens_scanned < 5);
+  REQUIRE(stats.tokens_reused > 9000);
+  REQUIRE(stats.groups_reused > 900);
+  REQUIRE(stats.nodes_added < full_size / 2);
+}
+
+TEST_CASE("IncrementalParser.benchmark", "[.][Incremental][Benchmark]") {
+  std::string src = "0";
+  for (int i = 0; i < 100000; ++i)
+    src += fmt::format(" + ({} * ({} - 1))", i % 10, i % 7);
+  Scanner scanner;
+  Parser parser;
+  FlatAst ast;
+  BENCHMARK("full reparse") {
+    ast.reset();
+    return parser.parse(scanner.tokenize_compact(src), src, ast);
+  };
+  IncrementalParser incremental(src);
+  auto offset = src.find('(', src.size() / 2) + 1;
+  int i = 0;
+  BENCHMARK("incremental edit") {
+    auto digit = std::string(1, static_cast<char>('0' + ++i % 10));
+    return incremental.edit({offset, 1, digit});
+  };
+}
@@ -0,0 +1,46 @@
+#include <catch2/catch_test_macros.hpp>
+#include <interner.hpp>
+#include <scanner.hpp>
+#include <string>
+#include <value.hpp>
+
+TEST_CASE("StringInterner", "[Interner]") {
+  SECTION("Equal strings share a handle") {
+    StringInterner interner;
+    std::string first = "identifier";
+    std::string second = "identifier";
+    auto a = interner.intern(first);
+    auto b = interner.intern(second);
+    REQUIRE(a == b);
+    REQUIRE(a.get() == b.get());
+    REQUIRE(a.view() == "identifier");
+    REQUIRE(a.view().data() != first.data());
+    REQUIRE_FALSE(a == interner.intern("other"));
+  }
+
+  SECTION("Stats") {
+    StringInterner interner;
+    interner.intern("abc");
+    interner.intern("abc");
+    interner.intern("abc");
+    interner.intern("de");
+    auto stats = interner.stats();
+    REQUIRE(stats.lookups == 4);
+    REQUIRE(stats.hits == 2);
+    REQUIRE(stats.unique_strings == 2);
+    REQUIRE(stats.bytes_stored == 5);
+    REQUIRE(stats.bytes_saved == 6);
+    REQUIRE(stats.hit_ratio() == 0.5);
+  }
+
+  SECTION("Tokens and values share the global table") {
+    Scanner scanner;
+    std::string src = R"=(fib fib "fib")=";
+    std::vector<Token> tokens;
+    for (auto token : scanner.tokenize(src))
+      tokens.push_back(token.value());
+    REQUIRE(tokens[0].interned_lexeme() == tokens[1].interned_lexeme());
+    REQUIRE(tokens[0].interned_lexeme() == tokens[2].interned_lexeme());
+    REQUIRE(Value::string(tokens[2].interned_lexeme()) == Value::string("fib"));
+  }
+}
@@ -0,0 +1,67 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <fmt/core.h>
+#include <keywords.hpp>
+#include <scanner.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The table the scanner used to build for every scan
+static const std::unordered_map<std::string, TokenType> keyword_map{
+    {"for", TokenType::For},       {"while", TokenType::While},
+    {"if", TokenType::If},         {"else", TokenType::Else},
+    {"class", TokenType::Class},   {"false", TokenType::False},
+    {"true", TokenType::True},     {"nil", TokenType::Nil},
+    {"or", TokenType::Or},         {"and", TokenType::And},
+    {"return", TokenType::Return}, {"super", TokenType::Super},
+    {"this", TokenType::This},     {"var", TokenType::Var},
+    {"def", TokenType::Def}};
+
+TEST_CASE("Keywords", "[Scanner]") {
+  for (const auto &[keyword, type] : keyword_map) {
+    INFO(keyword);
+    REQUIRE(identifier_type(keyword) == type);
+    // Prefixes and extensions of keywords are identifiers
+    REQUIRE(identifier_type(keyword.substr(0, keyword.size() - 1)) ==
+            TokenType::Identifier);
+    REQUIRE(identifier_type(keyword + "s") == TokenType::Identifier);
+  }
+  for (auto identifier : {"print", "fib", "n", "iff", "While", "thiss", "sup",
+                          "returns", "e", "classy", "nill"}) {
+    INFO(identifier);
+    REQUIRE(identifier_type(identifier) == TokenType::Identifier);
+  }
+}
+
+TEST_CASE("Keywords.benchmark", "[.][Scanner][Benchmark]") {
+  static constexpr std::string_view words[] = {
+      "counter", "if",    "value", "while", "x",   "return", "total",
+      "this",    "index", "for",   "var",   "fib", "result", "else"};
+  std::string src;
+  for (size_t i = 0; i < 200000; ++i)
+    src += fmt::format("{} ", words[i % std::size(words)]);
+  std::vector<std::string_view> identifiers;
+  for (size_t i = 0; i < 200000; ++i)
+    identifiers.push_back(words[i % std::size(words)]);
+
+  BENCHMARK("unordered_map<std::string>") {
+    size_t keywords = 0;
+    for (auto identifier : identifiers)
+      keywords += keyword_map.contains(std::string(identifier));
+    return keywords;
+  };
+  BENCHMARK("identifier_type") {
+    size_t keywords = 0;
+    for (auto identifier : identifiers)
+      keywords += identifier_type(identifier) != TokenType::Identifier;
+    return keywords;
+  };
+  Scanner scanner;
+  BENCHMARK("tokenize_compact identifier heavy") {
+    size_t count = 0;
+    for (auto &token : scanner.tokenize_compact(src))
+      count += token.has_value();
+    return count;
+  };
+}
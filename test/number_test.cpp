@@ -0,0 +1,126 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <charconv>
+#include <dfa_lexer.hpp>
+#include <number.hpp>
+#include <random>
+#include <scanner.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+double from_chars(std::string_view lexeme) {
+  double value = 0;
+  std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+  return value;
+}
+} // namespace
+
+TEST_CASE("Number.digit_run", "[Number]") {
+  REQUIRE(digit_run("") == 0);
+  REQUIRE(digit_run("x1") == 0);
+  REQUIRE(digit_run("123") == 3);
+  REQUIRE(digit_run("1234567") == 7);
+  REQUIRE(digit_run("12345678") == 8);
+  REQUIRE(digit_run("123456789") == 9);
+  REQUIRE(digit_run("12345678/") == 8);
+  REQUIRE(digit_run("0123456789012345678901.5") == 22);
+  // Bytes next to '0' and '9', and ones which carry out of their byte
+  for (int c = 0; c < 256; ++c) {
+    std::string str = "1234567" + std::string(1, static_cast<char>(c)) + "9";
+    auto expected = is_digit(static_cast<char>(c)) ? 9u : 7u;
+    INFO(c);
+    REQUIRE(digit_run(str) == expected);
+  }
+}
+
+TEST_CASE("Number.parse", "[Number]") {
+  auto lexeme =
+      GENERATE(as<std::string>{}, "0", "7", "12.5", "0.1", "3.14159",
+               "34325235235", "9007199254740992", "9007199254740993",
+               "12345678901234567890", "0.30000000000000004", "1.0000000001",
+               "123456789.987654321", "0000000000000000000000001.5",
+               "1.0000000000000000000000001", "179769313486231570000000000000"
+               "0000000000000000000000000000000000000000000000000000000000000"
+               "0000000000000000000000000000000000000000000000000000000000000"
+               "0000000000000000000000000000000000000000000000000000000000000"
+               "0000000000000000000000000000000000000000000000000000000000000"
+               "00000000000000000000000000000");
+  INFO(lexeme);
+  REQUIRE(parse_number(lexeme) == from_chars(lexeme));
+}
+
+TEST_CASE("Number.parse_random", "[Number]") {
+  std::mt19937_64 random(24);
+  std::uniform_int_distribution<size_t> length(1, 20);
+  std::uniform_int_distribution<int> digit(0, 9);
+  for (int i = 0; i < 100000; ++i) {
+    std::string lexeme;
+    for (auto n = length(random); n > 0; --n)
+      lexeme += static_cast<char>('0' + digit(random));
+    if (i % 2 == 0) {
+      lexeme += '.';
+      for (auto n = length(random); n > 0; --n)
+        lexeme += static_cast<char>('0' + digit(random));
+    }
+    INFO(lexeme);
+    REQUIRE(parse_number(lexeme) == from_chars(lexeme));
+  }
+}
+
+TEST_CASE("Number.lexing", "[Number]") {
+  auto backend = GENERATE(ScanBackend::Switch, ScanBackend::Dfa);
+  Scanner scanner(backend);
+  auto lex = [&](std::string_view src) {
+    std::vector<std::pair<TokenType, std::string_view>> tokens;
+    for (auto &token : scanner.tokenize_compact(src))
+      tokens.emplace_back(token->type, token->lexeme(src));
+    return tokens;
+  };
+  using enum TokenType;
+  using Tokens = std::vector<std::pair<TokenType, std::string_view>>;
+  REQUIRE(lex("12.5") == Tokens{{Number, "12.5"}, {EoF, ""}});
+  // Lox numbers have at most one fraction, the rest are more tokens
+  REQUIRE(lex("1.2.3") ==
+          Tokens{{Number, "1.2"}, {Dot, "."}, {Number, "3"}, {EoF, ""}});
+  REQUIRE(lex("1.") == Tokens{{Number, "1"}, {Dot, "."}, {EoF, ""}});
+  REQUIRE(lex("1.\n") == Tokens{{Number, "1"}, {Dot, "."}, {EoF, ""}});
+  REQUIRE(lex("1.x") ==
+          Tokens{{Number, "1"}, {Dot, "."}, {Identifier, "x"}, {EoF, ""}});
+  REQUIRE(lex("123456789012.25+7") ==
+          Tokens{{Number, "123456789012.25"}, {Plus, "+"}, {Number, "7"},
+                 {EoF, ""}});
+}
+
+TEST_CASE("Number.benchmark", "[.][Number][Benchmark]") {
+  std::string src;
+  for (int i = 0; i < 200000; ++i)
+    src += fmt::format("{} + {}.{} * ", i * 7919, i % 1000, i % 97);
+  src += "1";
+  Scanner scanner;
+  std::vector<std::string_view> lexemes;
+  for (auto &token : scanner.tokenize_compact(src))
+    if (token->type == TokenType::Number)
+      lexemes.push_back(token->lexeme(src));
+
+  BENCHMARK("std::from_chars") {
+    double sum = 0;
+    for (auto lexeme : lexemes)
+      sum += from_chars(lexeme);
+    return sum;
+  };
+  BENCHMARK("parse_number") {
+    double sum = 0;
+    for (auto lexeme : lexemes)
+      sum += parse_number(lexeme);
+    return sum;
+  };
+  BENCHMARK("tokenize_compact + parse_number") {
+    double sum = 0;
+    for (auto &token : scanner.tokenize_compact(src))
+      if (token->type == TokenType::Number)
+        sum += parse_number(token->lexeme(src));
+    return sum;
+  };
+}
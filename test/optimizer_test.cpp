@@ -0,0 +1,112 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <fmt/core.h>
+#include <interpreter.hpp>
+#include <optimizer.hpp>
+#include <scanner.hpp>
+#include <string>
+#include <vector>
+
+static Expr parse_expr(std::string_view src) {
+  Scanner scanner;
+  Parser parser;
+  return parser.parse(scanner.tokenize(src));
+}
+
+static PassManager only(std::string name, PassManager::Pass pass) {
+  PassManager manager;
+  manager.add(std::move(name), std::move(pass));
+  return manager;
+}
+
+TEST_CASE("Optimizer.fold_constants", "[Optimizer]") {
+  auto src = GENERATE(as<std::string>{}, "(1 + 2) * 3 == 9", "-(4 - 6) / 8",
+                      "!(1 < 2) != false", R"("a" < "b" == !false)",
+                      R"("x" == "x")", "nil == false", "1 / 0 > 2");
+  auto expr = parse_expr(src);
+  auto expected = std::visit(Interpreter(), expr);
+  auto stats = only("fold", fold_constants).run(expr);
+  INFO(src);
+  REQUIRE(std::holds_alternative<LiteralPtr>(expr));
+  REQUIRE(count_nodes(expr) == 1);
+  REQUIRE(std::visit(Interpreter(), expr) == expected);
+  REQUIRE(stats.size() == 1);
+  REQUIRE(stats[0].nodes_after == 1);
+  REQUIRE(stats[0].nodes_removed() == stats[0].nodes_before - 1);
+}
+
+TEST_CASE("Optimizer.fold_keeps_failures", "[Optimizer]") {
+  // These abort when evaluated, folding must not hide that
+  auto expr = parse_expr(R"((1 + 2) * (3 + "a"))");
+  fold_constants(expr);
+  REQUIRE(fmt::format("{}", expr) == "(Number Star (Number Plus String))");
+  expr = parse_expr("-true == !2");
+  fold_constants(expr);
+  REQUIRE(fmt::format("{}", expr) == "((Minus True) Equal (Bang Number))");
+}
+
+TEST_CASE("Optimizer.double_negation", "[Optimizer]") {
+  auto expr = parse_expr(R"(--(1 + "a") == !!("a" < 3))");
+  eliminate_double_negation(expr);
+  REQUIRE(fmt::format("{}", expr) ==
+          "((Number Plus String) Equal (String Less Number))");
+  // Only safe for operands of the right type
+  expr = parse_expr(R"(--"a" == !!2)");
+  eliminate_double_negation(expr);
+  REQUIRE(fmt::format("{}", expr) ==
+          "((Minus (Minus String)) Equal (Bang (Bang Number)))");
+}
+
+TEST_CASE("Optimizer.identities", "[Optimizer]") {
+  // 0 / 1 goes first, leaving x - 0
+  auto expr = parse_expr("(1 + 2) * 1 - 0 / 1");
+  simplify_identities(expr);
+  REQUIRE(fmt::format("{}", expr) == "(Number Plus Number)");
+  expr = parse_expr("1 * (3 - 2) / 1");
+  simplify_identities(expr);
+  REQUIRE(fmt::format("{}", expr) == "(Number Minus Number)");
+  // x + 0 is not x for x = -0
+  expr = parse_expr("(1 - 2) + 0");
+  simplify_identities(expr);
+  REQUIRE(count_nodes(expr) == 5);
+  // Strings must still fail
+  expr = parse_expr(R"("a" * 1)");
+  simplify_identities(expr);
+  REQUIRE(count_nodes(expr) == 3);
+}
+
+TEST_CASE("Optimizer.pass_manager", "[Optimizer]") {
+  auto expr = parse_expr(R"(!!((1 + 2) * 3 == 9) == --("a" + 1 * 1))");
+  auto manager = PassManager::with_default_passes();
+  auto stats = manager.run(expr);
+  REQUIRE(stats.size() == 3);
+  REQUIRE(stats[0].name == "fold_constants");
+  REQUIRE(stats[1].name == "eliminate_double_negation");
+  REQUIRE(stats[2].name == "simplify_identities");
+  for (size_t i = 1; i < stats.size(); ++i)
+    REQUIRE(stats[i].nodes_before == stats[i - 1].nodes_after);
+  REQUIRE(fmt::format("{}", expr) == "(True Equal (String Plus Number))");
+  REQUIRE_FALSE(fmt::format("{}", stats[0]).empty());
+}
+
+TEST_CASE("Optimizer.benchmark", "[.][Optimizer][Benchmark]") {
+  std::string src = "1";
+  for (int i = 0; i < 2000; ++i)
+    src += fmt::format(" + {} * ({} - 2) / 1 - --{}", i % 10, i % 7, i % 3);
+  auto expr = parse_expr(src);
+  auto optimized = parse_expr(src);
+  for (const auto &stats : PassManager::with_default_passes().run(optimized))
+    fmt::print("{}\n", stats);
+
+  BENCHMARK("evaluate unoptimized") {
+    return std::visit(Interpreter(), expr);
+  };
+  BENCHMARK("evaluate optimized") {
+    return std::visit(Interpreter(), optimized);
+  };
+  BENCHMARK("optimize") {
+    auto fresh = parse_expr(src);
+    return PassManager::with_default_passes().run(fresh).size();
+  };
+}
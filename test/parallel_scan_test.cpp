@@ -0,0 +1,114 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <fmt/core.h>
+#include <random>
+#include <scanner.hpp>
+#include <string>
+#include <thread_pool.hpp>
+#include <vector>
+
+static std::vector<std::expected<CompactToken, ScanError>>
+sequential_tokens(Scanner &scanner, std::string_view src) {
+  std::vector<std::expected<CompactToken, ScanError>> tokens;
+  for (auto &token : scanner.tokenize_compact(src))
+    tokens.push_back(token);
+  return tokens;
+}
+
+static void require_same(
+    const std::vector<std::expected<CompactToken, ScanError>> &actual,
+    const std::vector<std::expected<CompactToken, ScanError>> &expected) {
+  REQUIRE(actual.size() == expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    INFO(i);
+    REQUIRE(actual[i].has_value() == expected[i].has_value());
+    if (!expected[i]) {
+      REQUIRE(actual[i].error() == expected[i].error());
+      continue;
+    }
+    REQUIRE(actual[i]->type == expected[i]->type);
+    REQUIRE(actual[i]->offset == expected[i]->offset);
+    REQUIRE(actual[i]->length == expected[i]->length);
+    REQUIRE(actual[i]->line == expected[i]->line);
+  }
+}
+
+// Strings and comments spanning many lines, so chunk boundaries regularly
+// land inside them
+static std::string tricky_source(size_t lines) {
+  std::string src;
+  for (size_t i = 0; i < lines; ++i) {
+    switch (i % 6) {
+    case 0:
+      src += fmt::format("var x{} = {} + 2.5 * (y - 1);\n", i, i);
+      break;
+    case 1:
+      src += "/* comment\n with \"quotes\" and\n // slashes\n */ x != y;\n";
+      break;
+    case 2:
+      src += "print \"a string\n spanning /* lines\n\" >= 3;\n";
+      break;
+    case 3:
+      src += "// line comment \"not a string\n  \t\n";
+      break;
+    case 4:
+      src += "if (a <= b) { return !c; } @\n";
+      break;
+    case 5:
+      src += "\n\n\n";
+      break;
+    }
+  }
+  return src;
+}
+
+TEST_CASE("ParallelScan.identical", "[Scanner]") {
+  auto backend = GENERATE(ScanBackend::Switch, ScanBackend::Dfa);
+  auto chunks = GENERATE(size_t{1}, size_t{2}, size_t{3}, size_t{7},
+                         size_t{16}, size_t{64});
+  ThreadPool pool(4);
+  Scanner scanner(backend);
+  auto src = tricky_source(300);
+  require_same(scanner.tokenize_parallel(src, pool, chunks),
+               sequential_tokens(scanner, src));
+}
+
+TEST_CASE("ParallelScan.edge_cases", "[Scanner]") {
+  auto src = GENERATE(as<std::string>{}, "", "\n", "x", "\n\n\n   \n",
+                      "a\nb\nc\nd\ne\nf\n", "\"unterminated\n\n\n\n",
+                      "/* unterminated\n\n\n\n", "1\n2\n// trailing\n\n\n");
+  ThreadPool pool(3);
+  Scanner scanner;
+  for (size_t chunks = 1; chunks < 8; ++chunks)
+    require_same(scanner.tokenize_parallel(src, pool, chunks),
+                 sequential_tokens(scanner, src));
+}
+
+TEST_CASE("ParallelScan.random", "[Scanner]") {
+  static constexpr std::string_view alphabet = "ab1 \n\n\"/*!=.;(#";
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+  ThreadPool pool(4);
+  Scanner scanner;
+  for (int round = 0; round < 200; ++round) {
+    std::string src;
+    for (int i = 0; i < 200; ++i)
+      src += alphabet[pick(rng)];
+    require_same(scanner.tokenize_parallel(src, pool, 9),
+                 sequential_tokens(scanner, src));
+  }
+}
+
+TEST_CASE("ParallelScan.benchmark", "[.][Scanner][Benchmark]") {
+  auto src = tricky_source(600000);
+  Scanner scanner;
+  BENCHMARK("sequential") { return sequential_tokens(scanner, src).size(); };
+  auto cores = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned threads = 1; threads <= cores; threads *= 2) {
+    ThreadPool pool(threads);
+    BENCHMARK(fmt::format("parallel, {} threads", threads)) {
+      return scanner.tokenize_parallel(src, pool, threads).size();
+    };
+  }
+}
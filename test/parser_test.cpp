@@ -1,5 +1,7 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <expected>
+#include <flat_ast.hpp>
 #include <fmt/core.h>
 #include <interpreter.hpp>
 #include <parser.hpp>
@@ -23,7 +25,7 @@ TEST_CASE("ExpressionAST", "[Parser]") {
       std::string src = R"=(34 >2)=";
       auto expr = create_scenerio(src);
       REQUIRE("(Number Greater Number)" == fmt::format("{}", expr));
-      auto result = std::get<bool>(std::visit(Interpreter(), expr));
+      auto result = std::visit(Interpreter(), expr).as_bool();
       REQUIRE(result);
     }
     SECTION("GreateEqual") {
@@ -31,7 +33,7 @@ TEST_CASE("ExpressionAST", "[Parser]") {
       std::string src = R"=(34 >=2)=";
       auto expr = create_scenerio(src);
       REQUIRE("(Number GreaterEqual Number)" == fmt::format("{}", expr));
-      auto result = std::get<bool>(std::visit(Interpreter(), expr));
+      auto result = std::visit(Interpreter(), expr).as_bool();
       REQUIRE(result);
     }
     SECTION("Less") {
@@ -39,7 +41,7 @@ TEST_CASE("ExpressionAST", "[Parser]") {
       std::string src = R"=(34 <2)=";
       auto expr = create_scenerio(src);
       REQUIRE("(Number Less Number)" == fmt::format("{}", expr));
-      auto result = std::get<bool>(std::visit(Interpreter(), expr));
+      auto result = std::visit(Interpreter(), expr).as_bool();
       REQUIRE_FALSE(result);
     }
     SECTION("LessEqual") {
@@ -47,35 +49,35 @@ TEST_CASE("ExpressionAST", "[Parser]") {
       std::string src = R"=(34 <=2)=";
       auto expr = create_scenerio(src);
       REQUIRE("(Number LessEqual Number)" == fmt::format("{}", expr));
-      auto result = std::get<bool>(std::visit(Interpreter(), expr));
+      auto result = std::visit(Interpreter(), expr).as_bool();
       REQUIRE_FALSE(result);
     }
     SECTION("Equal") {
       std::string src = R"=(34==2)=";
       auto expr = create_scenerio(src);
       REQUIRE("(Number Equal Number)" == fmt::format("{}", expr));
-      auto result = std::get<bool>(std::visit(Interpreter(), expr));
+      auto result = std::visit(Interpreter(), expr).as_bool();
       REQUIRE_FALSE(result);
     }
     SECTION("Equal") {
       std::string src = R"=(34==34)=";
       auto expr = create_scenerio(src);
       REQUIRE("(Number Equal Number)" == fmt::format("{}", expr));
-      auto result = std::get<bool>(std::visit(Interpreter(), expr));
+      auto result = std::visit(Interpreter(), expr).as_bool();
       REQUIRE(result);
     }
     SECTION("NotEqual") {
       std::string src = R"=(34!=2)=";
       auto expr = create_scenerio(src);
       REQUIRE("(Number BangEqual Number)" == fmt::format("{}", expr));
-      auto result = std::get<bool>(std::visit(Interpreter(), expr));
+      auto result = std::visit(Interpreter(), expr).as_bool();
       REQUIRE(result);
     }
     SECTION("NotEqual") {
       std::string src = R"=(34!=34)=";
       auto expr = create_scenerio(src);
       REQUIRE("(Number BangEqual Number)" == fmt::format("{}", expr));
-      auto result = std::get<bool>(std::visit(Interpreter(), expr));
+      auto result = std::visit(Interpreter(), expr).as_bool();
       REQUIRE_FALSE(result);
     }
     SECTION("String") {
@@ -83,7 +85,7 @@ TEST_CASE("ExpressionAST", "[Parser]") {
       std::string src = R"=("This is test"== "This is test")=";
       auto expr = create_scenerio(src);
       REQUIRE("(String Equal String)" == fmt::format("{}", expr));
-      auto result = std::get<bool>(std::visit(Interpreter(), expr));
+      auto result = std::visit(Interpreter(), expr).as_bool();
       REQUIRE(result);
     }
 
@@ -93,7 +95,7 @@ TEST_CASE("ExpressionAST", "[Parser]") {
       auto expr = create_scenerio(src);
       REQUIRE("((Number Greater Number) BangEqual Number)" ==
               fmt::format("{}", expr));
-      auto result = std::get<bool>(std::visit(Interpreter(), expr));
+      auto result = std::visit(Interpreter(), expr).as_bool();
       REQUIRE(result);
     }
   }
@@ -103,7 +105,7 @@ TEST_CASE("ExpressionAST", "[Parser]") {
     auto expr = create_scenerio(src);
     REQUIRE("((Number Plus Number) Minus (Number Slash Number))" ==
             fmt::format("{}", expr));
-    auto result = std::get<float>(std::visit(Interpreter(), expr));
+    auto result = std::visit(Interpreter(), expr).as_number();
     REQUIRE(result == 58);
   }
 
@@ -112,7 +114,61 @@ TEST_CASE("ExpressionAST", "[Parser]") {
     auto expr = create_scenerio(src);
     REQUIRE("(Number Plus ((Number Minus Number) Slash Number))" ==
             fmt::format("{}", expr));
-    auto result = std::get<float>(std::visit(Interpreter(), expr));
-    REQUIRE(result == ((16.f / 3.f) + 34.f));
+    auto result = std::visit(Interpreter(), expr).as_number();
+    REQUIRE(result == ((16.0 / 3.0) + 34.0));
   }
 }
+
+TEST_CASE("ExpressionAST.precedence", "[Parser]") {
+  REQUIRE(fmt::format("{}", create_scenerio("1 == 2 < 3 + 4 * -5")) ==
+          "(Number Equal (Number Less (Number Plus (Number Star (Minus "
+          "Number)))))");
+  REQUIRE(fmt::format("{}", create_scenerio("1 * 2 + 3 < 4 != 5")) ==
+          "((((Number Star Number) Plus Number) Less Number) BangEqual "
+          "Number)");
+  REQUIRE(fmt::format("{}", create_scenerio("!-(1 - 2 - 3) / 4")) ==
+          "((Bang (Minus ((Number Minus Number) Minus Number))) Slash "
+          "Number)");
+}
+
+TEST_CASE("ExpressionAST.deep_nesting", "[Parser]") {
+  // Deep enough to overflow the native stack of a recursive parser
+  static constexpr size_t depth = 1'000'000;
+  std::string src = std::string(depth, '(') + "1 + 2" + std::string(depth, ')');
+  Scanner scanner;
+  Parser parser;
+  FlatAst ast;
+  parser.parse(scanner.tokenize_compact(src), src, ast);
+  REQUIRE(ast.size() == 3);
+  REQUIRE(Interpreter()(ast).as_number() == 3);
+
+  src = std::string(depth, '-') + "1";
+  ast.reset();
+  parser.parse(scanner.tokenize_compact(src), src, ast);
+  REQUIRE(ast.size() == depth + 1);
+}
+
+TEST_CASE("ExpressionAST.benchmark", "[.][Parser][Benchmark]") {
+  Scanner scanner;
+  Parser parser;
+  FlatAst ast;
+  auto tokens_of = [&scanner](std::string_view src) {
+    std::vector<Token> tokens;
+    for (auto &token : scanner.tokenize(src))
+      tokens.push_back(token.value());
+    return tokens;
+  };
+  auto literal = tokens_of("42");
+  BENCHMARK("single literal") {
+    ast.reset();
+    return parser.parse(literal, ast);
+  };
+  std::string src = "1";
+  for (int i = 0; i < 10000; ++i)
+    src += fmt::format(" + {} * ({} - 2) == -{}", i % 10, i % 7, i % 3);
+  auto expression = tokens_of(src);
+  BENCHMARK("mixed expression") {
+    ast.reset();
+    return parser.parse(expression, ast);
+  };
+}
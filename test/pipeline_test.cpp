@@ -0,0 +1,101 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <flat_ast.hpp>
+#include <interpreter.hpp>
+#include <pipeline.hpp>
+#include <spsc_ring.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("SpscRing.order", "[Pipeline]") {
+  SpscRing<size_t> ring(8);
+  REQUIRE(ring.capacity() == 8);
+  static constexpr size_t count = 200000;
+  std::jthread producer([&ring] {
+    for (size_t i = 0; i < count; ++i)
+      ring.push(i);
+  });
+  size_t value = 0;
+  for (size_t i = 0; i < count; ++i) {
+    REQUIRE(ring.pop(value));
+    REQUIRE(value == i);
+  }
+  REQUIRE_FALSE(ring.try_pop(value));
+}
+
+TEST_CASE("SpscRing.close", "[Pipeline]") {
+  SpscRing<int> ring(2);
+  REQUIRE(ring.try_push(1));
+  REQUIRE(ring.try_push(2));
+  REQUIRE_FALSE(ring.try_push(3));
+  ring.close();
+  // A full ring no longer blocks the producer once closed
+  REQUIRE_FALSE(ring.push(3));
+  int value = 0;
+  REQUIRE(ring.pop(value));
+  REQUIRE(value == 1);
+  REQUIRE(ring.pop(value));
+  REQUIRE(value == 2);
+  REQUIRE_FALSE(ring.pop(value));
+}
+
+TEST_CASE("Pipeline.parse", "[Pipeline]") {
+  auto src = GENERATE(as<std::string>{}, "1 + 2 * 3", "(1 + 2) * -3 >= 9",
+                      R"("a" == "a")", "!(4 / 2 < 1) == true", "",
+                      // Parser stops at the second number, the scanner must
+                      // not be left blocked on a full ring
+                      "1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20");
+  auto capacity = GENERATE(size_t{2}, size_t{4096});
+  Scanner scanner;
+  Parser parser;
+  std::vector<Token> tokens;
+  for (auto &token : scanner.tokenize(src))
+    tokens.push_back(token.value());
+  FlatAst expected;
+  parser.parse(tokens, expected);
+
+  FlatAst ast;
+  parse_pipelined(scanner, parser, src, ast, capacity);
+  INFO(src);
+  REQUIRE(ast.size() == expected.size());
+  if (ast.root() != invalid_node) {
+    REQUIRE(fmt::format("{}", ast) == fmt::format("{}", expected));
+    REQUIRE(Interpreter()(ast) == Interpreter()(expected));
+  }
+}
+
+TEST_CASE("Pipeline.large", "[Pipeline]") {
+  std::string src = "0";
+  for (int i = 1; i <= 20000; ++i)
+    src += fmt::format(" + {} * ({} - 1)", i % 10, i % 3);
+  Scanner scanner;
+  Parser parser;
+  FlatAst ast;
+  parse_pipelined(scanner, parser, src, ast, 16);
+  double expected = 0;
+  for (int i = 1; i <= 20000; ++i)
+    expected += (i % 10) * ((i % 3) - 1);
+  REQUIRE(Interpreter()(ast).as_number() == expected);
+}
+
+TEST_CASE("Pipeline.benchmark", "[.][Pipeline][Benchmark]") {
+  std::string src = "1";
+  for (int i = 0; i < 200000; ++i)
+    src += fmt::format(" + {} * ({} - \"s\" == nil)", i % 10, i % 7);
+  Scanner scanner;
+  Parser parser;
+  FlatAst ast;
+  BENCHMARK("materialized vector<Token>") {
+    std::vector<Token> tokens;
+    for (auto &token : scanner.tokenize(src))
+      tokens.push_back(token.value());
+    ast.reset();
+    return parser.parse(tokens, ast);
+  };
+  BENCHMARK("pipelined") {
+    ast.reset();
+    return parse_pipelined(scanner, parser, src, ast);
+  };
+}
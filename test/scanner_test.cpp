@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
 #include <expected>
 #include <fmt/core.h>
@@ -88,3 +89,40 @@ TEST_CASE("Tokenization.multiline_comment", "[Scanner]") {
     }
   }
 }
+
+TEST_CASE("Tokenization.compact", "[Scanner]") {
+  Scanner scanner;
+  std::string src = R"=(def fib(n){
+        /* a * comment */ if (n <= 3) return "one
+two"; // trailing
+        return fib(n-1) + 2.5;
+      }
+      )=";
+  std::vector<Token> tokens;
+  for (auto token : scanner.tokenize(src)) {
+    REQUIRE(token);
+    tokens.push_back(token.value());
+  }
+  size_t index = 0;
+  for (auto token : scanner.tokenize_compact(src)) {
+    REQUIRE(token);
+    REQUIRE(index < tokens.size());
+    REQUIRE(token.value().type == tokens[index].type());
+    REQUIRE(token.value().lexeme(src) == tokens[index].lexeme());
+    ++index;
+  }
+  REQUIRE(index == tokens.size());
+
+  std::vector<CompactToken> compact;
+  for (auto token : scanner.tokenize_compact(src))
+    compact.push_back(token.value());
+  REQUIRE(compact[0].offset == 0);
+  REQUIRE(compact[0].line == 1);
+  // "one\ntwo" string starts on line 2 and ends on line 3
+  auto string_token = std::ranges::find(compact, TokenType::String,
+                                        &CompactToken::type);
+  REQUIRE(string_token->lexeme(src) == "one\ntwo");
+  REQUIRE(string_token->line == 3);
+  REQUIRE(compact.back().type == TokenType::EoF);
+  REQUIRE(compact.back().line == 6);
+}
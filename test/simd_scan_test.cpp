@@ -0,0 +1,102 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <fmt/core.h>
+#include <random>
+#include <scanner.hpp>
+#include <simd_scan.hpp>
+#include <vector>
+
+static std::vector<SimdLevel> available_levels() {
+  std::vector<SimdLevel> levels{SimdLevel::Scalar};
+  if (best_simd_level() >= SimdLevel::SSE2)
+    levels.push_back(SimdLevel::SSE2);
+  if (best_simd_level() >= SimdLevel::AVX2)
+    levels.push_back(SimdLevel::AVX2);
+  return levels;
+}
+
+// Mostly the bytes the kernels look for so every lane position gets hit
+static std::string random_text(std::mt19937 &rng, size_t size) {
+  static constexpr std::string_view alphabet = "  \t\r\n\n*/\"ab";
+  std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+  std::string text(size, ' ');
+  for (auto &c : text)
+    c = alphabet[pick(rng)];
+  return text;
+}
+
+TEST_CASE("SimdScan", "[Scanner]") {
+  SECTION("All levels agree with scalar") {
+    std::mt19937 rng(42);
+    const auto &scalar = scan_kernels(SimdLevel::Scalar);
+    for (size_t size = 0; size < 200; ++size) {
+      auto text = random_text(rng, size);
+      for (auto level : available_levels()) {
+        const auto &kernels = scan_kernels(level);
+        for (char needle : {'"', '\n', 'a'}) {
+          std::uint32_t expected_lines = 0, lines = 0;
+          REQUIRE(kernels.find_byte(text, needle, lines) ==
+                  scalar.find_byte(text, needle, expected_lines));
+          REQUIRE(lines == expected_lines);
+        }
+        std::uint32_t expected_lines = 0, lines = 0;
+        REQUIRE(kernels.find_comment_end(text, lines) ==
+                scalar.find_comment_end(text, expected_lines));
+        REQUIRE(lines == expected_lines);
+        expected_lines = lines = 0;
+        REQUIRE(kernels.skip_whitespace(text, lines) ==
+                scalar.skip_whitespace(text, expected_lines));
+        REQUIRE(lines == expected_lines);
+      }
+    }
+  }
+
+  SECTION("Long runs") {
+    std::string text(1000, ' ');
+    text[500] = '\n';
+    text += "*/x";
+    for (auto level : available_levels()) {
+      const auto &kernels = scan_kernels(level);
+      std::uint32_t lines = 0;
+      REQUIRE(kernels.skip_whitespace(text, lines) == 1000);
+      REQUIRE(lines == 1);
+      lines = 0;
+      REQUIRE(kernels.find_comment_end(text, lines) == 1000);
+      REQUIRE(lines == 1);
+      lines = 0;
+      REQUIRE(kernels.find_byte(text, 'x', lines) == 1002);
+      REQUIRE(lines == 1);
+    }
+  }
+}
+
+static std::string comment_heavy_source(size_t lines) {
+  std::string src;
+  for (size_t i = 0; i < lines; ++i) {
+    src += "    // a fairly long line comment describing the next statement\n";
+    src += "    /* block comment spanning\n       two lines */\n";
+    src += fmt::format(
+        "    var s{} = \"a string literal with some length to it\";\n", i);
+  }
+  return src;
+}
+
+TEST_CASE("SimdScan.benchmark", "[.][Scanner][Benchmark]") {
+  auto src = comment_heavy_source(20000);
+  Scanner scanner;
+  fmt::print("{} bytes of comment and string heavy source\n", src.size());
+
+  BENCHMARK("tokenize_compact") {
+    size_t count = 0;
+    for (auto &token : scanner.tokenize_compact(src))
+      count += token.has_value();
+    return count;
+  };
+  for (auto level : available_levels()) {
+    const auto &kernels = scan_kernels(level);
+    BENCHMARK(fmt::format("find_byte level {}", static_cast<int>(level))) {
+      std::uint32_t lines = 0;
+      return kernels.find_byte(src, '\0', lines) + lines;
+    };
+  }
+}
@@ -0,0 +1,69 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <scanner.hpp>
+#include <source_file.hpp>
+#include <unistd.h>
+
+static std::filesystem::path write_temp_file(std::string_view contents) {
+  auto path = std::filesystem::temp_directory_path() /
+              ("jlox_source_file_test_" + std::to_string(::getpid()));
+  std::ofstream file(path, std::ios::binary);
+  file << contents;
+  return path;
+}
+
+TEST_CASE("SourceFile", "[Scanner]") {
+  std::string src = "var a = 34 >= 2;\n// comment\n\"str ing\"\n";
+
+  SECTION("Regular file is mapped") {
+    auto path = write_temp_file(src);
+    auto file = SourceFile::open(path.string());
+    REQUIRE(file);
+    REQUIRE(file->is_mapped());
+    REQUIRE(file->contents() == src);
+    auto moved = std::move(*file);
+    REQUIRE(moved.contents() == src);
+    std::filesystem::remove(path);
+  }
+
+  SECTION("Empty file") {
+    auto path = write_temp_file("");
+    auto file = SourceFile::open(path.string());
+    REQUIRE(file);
+    REQUIRE(file->contents().empty());
+    std::filesystem::remove(path);
+  }
+
+  SECTION("Pipe is read") {
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+    REQUIRE(::write(fds[1], src.data(), src.size()) ==
+            static_cast<ssize_t>(src.size()));
+    ::close(fds[1]);
+    auto file = SourceFile::open("/proc/self/fd/" + std::to_string(fds[0]));
+    ::close(fds[0]);
+    REQUIRE(file);
+    REQUIRE_FALSE(file->is_mapped());
+    REQUIRE(file->contents() == src);
+  }
+
+  SECTION("Missing file") {
+    auto file = SourceFile::open("/this/file/does/not/exist");
+    REQUIRE_FALSE(file);
+  }
+
+  SECTION("Scanner::scan") {
+    auto path = write_temp_file(src);
+    Scanner scanner;
+    auto stats = scanner.scan(path.string());
+    REQUIRE(stats.bytes == src.size());
+    REQUIRE(stats.errors == 0);
+    // var a = 34 >= 2 ; "str ing" EoF
+    REQUIRE(stats.tokens == 9);
+    REQUIRE(scanner.tokens().size() == 9);
+    REQUIRE(scanner.tokens()[7].lexeme() == "str ing");
+    std::filesystem::remove(path);
+  }
+}
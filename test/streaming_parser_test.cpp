@@ -0,0 +1,64 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <flat_ast.hpp>
+#include <interpreter.hpp>
+#include <parser.hpp>
+#include <scanner.hpp>
+#include <string>
+#include <vector>
+
+TEST_CASE("StreamingParser.matches_span", "[Parser]") {
+  auto src = GENERATE(as<std::string>{}, "1 + 2 * 3", "(1 + 2) * -3 >= 9",
+                      R"("a" == "a")", "!(4 / 2 < 1) == true", "nil", "",
+                      "((((1 + 2) - 3) * 4) / 5) + 6 - 7 * 8 / 9");
+  Scanner scanner;
+  Parser parser;
+  std::vector<Token> tokens;
+  for (auto &token : scanner.tokenize(src))
+    tokens.push_back(token.value());
+  FlatAst expected;
+  parser.parse(tokens, expected);
+  INFO(src);
+
+  FlatAst ast;
+  parser.parse(scanner.tokenize(src), ast);
+  REQUIRE(ast.size() == expected.size());
+  FlatAst compact_ast;
+  parser.parse(scanner.tokenize_compact(src), src, compact_ast);
+  REQUIRE(compact_ast.size() == expected.size());
+  if (expected.root() == invalid_node)
+    return;
+  REQUIRE(fmt::format("{}", ast) == fmt::format("{}", expected));
+  REQUIRE(fmt::format("{}", compact_ast) == fmt::format("{}", expected));
+  REQUIRE(Interpreter()(ast) == Interpreter()(expected));
+  REQUIRE(Interpreter()(compact_ast) == Interpreter()(expected));
+
+  auto expr = parser.parse(scanner.tokenize(src));
+  REQUIRE(fmt::format("{}", expr) == fmt::format("{}", expected));
+  REQUIRE(std::visit(Interpreter(), expr) == Interpreter()(expected));
+}
+
+TEST_CASE("StreamingParser.benchmark", "[.][Parser][Benchmark]") {
+  std::string src = "1";
+  for (int i = 0; i < 200000; ++i)
+    src += fmt::format(" + {} * ({} - 2)", i % 10, i % 7);
+  Scanner scanner;
+  Parser parser;
+  FlatAst ast;
+  BENCHMARK("materialized vector<Token>") {
+    std::vector<Token> tokens;
+    for (auto &token : scanner.tokenize(src))
+      tokens.push_back(token.value());
+    ast.reset();
+    return parser.parse(tokens, ast);
+  };
+  BENCHMARK("streaming Token") {
+    ast.reset();
+    return parser.parse(scanner.tokenize(src), ast);
+  };
+  BENCHMARK("streaming CompactToken") {
+    ast.reset();
+    return parser.parse(scanner.tokenize_compact(src), src, ast);
+  };
+}
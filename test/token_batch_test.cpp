@@ -0,0 +1,97 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <flat_ast.hpp>
+#include <interpreter.hpp>
+#include <parser.hpp>
+#include <scanner.hpp>
+#include <string>
+#include <token_batch.hpp>
+#include <vector>
+
+TEST_CASE("TokenBatch.matches_tokenize", "[Scanner]") {
+  std::string_view src =
+      R"=(def fib(n){ if (n < 3.5) return "one"; @ return fib(n-1) + 2; })=";
+  auto capacity = GENERATE(size_t{1}, size_t{3}, size_t{7}, size_t{1024});
+  Scanner scanner;
+
+  std::vector<CompactToken> expected;
+  size_t expected_errors = 0;
+  for (auto &token : scanner.tokenize_compact(src)) {
+    if (token)
+      expected.push_back(*token);
+    else
+      ++expected_errors;
+  }
+
+  TokenBatch batch(capacity);
+  size_t index = 0, errors = 0, resumes = 0;
+  for (auto &filled : scanner.tokenize_batch(src, batch)) {
+    ++resumes;
+    REQUIRE(filled.size() <= capacity);
+    errors += filled.errors().size();
+    size_t number = 0;
+    for (size_t i = 0; i < filled.size(); ++i, ++index) {
+      REQUIRE(index < expected.size());
+      REQUIRE(filled.types()[i] == expected[index].type);
+      REQUIRE(filled.offsets()[i] == expected[index].offset);
+      REQUIRE(filled.lengths()[i] == expected[index].length);
+      REQUIRE(filled.lines()[i] == expected[index].line);
+      REQUIRE(filled.lexeme(i) == expected[index].lexeme(src));
+      if (filled.types()[i] == TokenType::Number)
+        REQUIRE(filled.numbers()[number++] ==
+                std::stod(std::string(filled.lexeme(i))));
+    }
+    REQUIRE(number == filled.numbers().size());
+  }
+  REQUIRE(index == expected.size());
+  REQUIRE(errors == expected_errors);
+  REQUIRE(resumes == (expected.size() + capacity - 1) / capacity);
+}
+
+TEST_CASE("TokenBatch.parse", "[Parser]") {
+  auto src = GENERATE(as<std::string>{}, "1 + 2 * 3", "(1 + 2) * -3 >= 9",
+                      R"("a" == "a")", "!(4 / 2 < 1) == true", "nil == nil",
+                      "((((1 + 2) - 3) * 4) / 5) + 6 - 7 * 8 / 9");
+  auto capacity = GENERATE(size_t{1}, size_t{2}, size_t{1024});
+  Scanner scanner;
+  Parser parser;
+  Interpreter interpreter;
+
+  std::vector<Token> tokens;
+  for (auto &token : scanner.tokenize(src))
+    tokens.push_back(token.value());
+  FlatAst expected_ast;
+  parser.parse(tokens, expected_ast);
+
+  TokenBatch batch(capacity);
+  FlatAst ast;
+  parser.parse(scanner.tokenize_batch(src, batch), ast);
+  INFO(src);
+  REQUIRE(fmt::format("{}", ast) == fmt::format("{}", expected_ast));
+  REQUIRE(interpreter(ast) == interpreter(expected_ast));
+
+  auto expr = parser.parse(scanner.tokenize_batch(src, batch));
+  REQUIRE(fmt::format("{}", expr) == fmt::format("{}", expected_ast));
+}
+
+TEST_CASE("TokenBatch.benchmark", "[.][Parser][Benchmark]") {
+  std::string src = "1";
+  for (int i = 0; i < 100000; ++i)
+    src += fmt::format(" + {} * ({} - 2)", i % 10, i % 7);
+  Scanner scanner;
+  Parser parser;
+  FlatAst ast;
+  BENCHMARK("tokenize, span<Token>") {
+    std::vector<Token> tokens;
+    for (auto &token : scanner.tokenize(src))
+      tokens.push_back(token.value());
+    ast.reset();
+    return parser.parse(tokens, ast);
+  };
+  TokenBatch batch;
+  BENCHMARK("tokenize_batch") {
+    ast.reset();
+    return parser.parse(scanner.tokenize_batch(src, batch), ast);
+  };
+}
@@ -0,0 +1,39 @@
+#include <catch2/catch_test_macros.hpp>
+#include <flat_ast.hpp>
+#include <interpreter.hpp>
+#include <parser.hpp>
+#include <scanner.hpp>
+#include <string>
+#include <trace.hpp>
+
+TEST_CASE("Trace.pipeline", "[Trace]") {
+  trace::reset();
+  std::string src = "(1 + 2) * -3 == \"abc\"";
+  Scanner scanner;
+  Parser parser;
+  FlatAst ast;
+  parser.parse(scanner.tokenize_compact(src), src, ast);
+  Interpreter()(ast);
+  auto json = trace::chrome_trace_json();
+  REQUIRE(json.find("\"traceEvents\"") != std::string::npos);
+
+#ifdef JLOX_TRACE
+  // 11 tokens with EoF, 8 nodes, each evaluated once
+  REQUIRE(trace::counter(trace::Counter::Tokens) == 11);
+  REQUIRE(trace::counter(trace::Counter::Nodes) == 8);
+  REQUIRE(trace::counter(trace::Counter::Evaluations) == 8);
+  REQUIRE(json.find("\"name\": \"Scanner::tokenize\"") != std::string::npos);
+  REQUIRE(json.find("\"name\": \"Parser::parse\"") != std::string::npos);
+  REQUIRE(json.find("\"name\": \"Interpreter\"") != std::string::npos);
+  REQUIRE(json.find("\"tokens\": 11") != std::string::npos);
+
+  trace::reset();
+  REQUIRE(trace::counter(trace::Counter::Tokens) == 0);
+  REQUIRE(trace::chrome_trace_json().find("\"ph\": \"X\"") ==
+          std::string::npos);
+#else
+  // Compiled out, nothing is recorded
+  REQUIRE(trace::counter(trace::Counter::Tokens) == 0);
+  REQUIRE(json.find("\"ph\"") == std::string::npos);
+#endif
+}
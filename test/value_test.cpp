@@ -0,0 +1,107 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <fmt/core.h>
+#include <limits>
+#include <value.hpp>
+
+TEST_CASE("Value", "[Value]") {
+  SECTION("Types") {
+    REQUIRE(Value(1.5).is_number());
+    REQUIRE(Value(1.5).as_number() == 1.5);
+    REQUIRE(Value(-0.0).is_number());
+    REQUIRE(Value(std::numeric_limits<double>::infinity()).is_number());
+    REQUIRE(Value(true).is_bool());
+    REQUIRE(Value(true).as_bool());
+    REQUIRE_FALSE(Value(false).as_bool());
+    REQUIRE(Value().is_nil());
+    REQUIRE_FALSE(Value().is_bool());
+    auto str = Value::string("This is test");
+    REQUIRE(str.is_string());
+    REQUIRE_FALSE(str.is_number());
+    REQUIRE(str.as_string() == "This is test");
+  }
+
+  SECTION("NaN") {
+    auto nan = Value(std::nan(""));
+    REQUIRE(nan.is_number());
+    REQUIRE(std::isnan(nan.as_number()));
+    REQUIRE_FALSE(nan == nan);
+    // A NaN carrying our tag bits must not turn into nil
+    auto tagged = Value(std::bit_cast<double>(0x7ffc000000000001));
+    REQUIRE(tagged.is_number());
+    REQUIRE_FALSE(tagged.is_nil());
+  }
+
+  SECTION("Comparison") {
+    REQUIRE(Value(2.0) == Value(2.0));
+    REQUIRE(Value(2.0) != Value(true));
+    REQUIRE(Value::string("abc") == Value::string("abc"));
+    REQUIRE(Value::string("abc") < Value::string("abd"));
+    REQUIRE(Value(1.0) < Value(2.0));
+    REQUIRE(Value() == Value());
+    // Different types are ordered by type, strings first
+    REQUIRE(Value::string("z") < Value(1.0));
+    REQUIRE(Value(1.0) < Value(false));
+  }
+
+  SECTION("Integers") {
+    auto big = Value::integer(34325235235);
+    REQUIRE(big.is_int());
+    REQUIRE(big.is_number());
+    REQUIRE(big.type() == ValueType::Number);
+    REQUIRE(big.as_int() == 34325235235);
+    REQUIRE(Value::integer(-7).as_int() == -7);
+    REQUIRE(Value::integer(-7).as_number() == -7.0);
+    REQUIRE_FALSE(Value(1.5).is_int());
+    REQUIRE_FALSE(Value().is_int());
+    REQUIRE_FALSE(Value(true).is_int());
+    // Past 48 bits they are doubles
+    auto huge = Value::integer(std::int64_t{1} << 50);
+    REQUIRE_FALSE(huge.is_int());
+    REQUIRE(huge.as_number() == 1125899906842624.0);
+
+    REQUIRE(Value::number(3.0).is_int());
+    REQUIRE_FALSE(Value::number(3.5).is_int());
+    REQUIRE_FALSE(Value::number(-0.0).is_int());
+    REQUIRE_FALSE(Value::number(std::nan("")).is_int());
+    REQUIRE_FALSE(Value::number(1e300).is_int());
+
+    // Never distinguishable from the same double
+    REQUIRE(Value::integer(2) == Value(2.0));
+    REQUIRE(Value::integer(2) < Value(2.5));
+    REQUIRE(Value::integer(-3) < Value::integer(2));
+    REQUIRE(Value::integer(-3) != Value::integer(3));
+  }
+
+  SECTION("Integer arithmetic") {
+    auto i = [](std::int64_t n) { return Value::integer(n); };
+    REQUIRE(add_numbers(i(2), i(3)).is_int());
+    REQUIRE(add_numbers(i(2), i(3)).as_int() == 5);
+    REQUIRE(add_numbers(i(2), Value(0.5)).as_number() == 2.5);
+    REQUIRE(subtract_numbers(i(2), i(30)).as_int() == -28);
+    REQUIRE(multiply_numbers(i(34325235235), i(3)).as_int() == 102975705705);
+    // Overflowing 48 bits and 64 bits promotes to double
+    auto limit = std::int64_t{1} << 46;
+    REQUIRE_FALSE(add_numbers(i(limit), i(limit)).is_int());
+    REQUIRE(add_numbers(i(limit), i(limit)).as_number() == 140737488355328.0);
+    auto product = multiply_numbers(i(limit), i(limit));
+    REQUIRE_FALSE(product.is_int());
+    REQUIRE(product.as_number() == 4951760157141521099596496896.0);
+    REQUIRE(divide_numbers(i(7), i(2)).as_number() == 3.5);
+    REQUIRE(negate_number(i(5)).as_int() == -5);
+    REQUIRE(negate_number(i(-limit * 2)).as_number() == 140737488355328.0);
+
+    // Zeros with a sign, as doubles would give them
+    REQUIRE(std::signbit(negate_number(i(0)).as_number()));
+    REQUIRE(std::signbit(multiply_numbers(i(0), i(-5)).as_number()));
+    REQUIRE_FALSE(std::signbit(multiply_numbers(i(0), i(5)).as_number()));
+    REQUIRE_FALSE(std::signbit(subtract_numbers(i(3), i(3)).as_number()));
+  }
+
+  SECTION("Format") {
+    REQUIRE(fmt::format("{}", Value(1.0)) == "Number");
+    REQUIRE(fmt::format("{}", Value(true)) == "True");
+    REQUIRE(fmt::format("{}", Value::string("")) == "String");
+    REQUIRE(fmt::format("{}", Value()) == "Nil");
+  }
+}
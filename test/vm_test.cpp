@@ -0,0 +1,82 @@
+#include <bytecode.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <fmt/core.h>
+#include <interpreter.hpp>
+#include <parser.hpp>
+#include <scanner.hpp>
+#include <vm.hpp>
+
+static Expr parse_source(std::string_view src) {
+  Scanner scanner;
+  Parser parser;
+  std::vector<Token> tokens;
+  for (auto i : scanner.tokenize(src)) {
+    tokens.push_back(i.value());
+  }
+  return parser.parse(tokens);
+}
+
+TEST_CASE("VM", "[VM]") {
+  SECTION("Same result as Interpreter") {
+    auto src = GENERATE(as<std::string>{}, "34 >2", "34 >=2", "34 <2",
+                        "34 <=2", "34==2", "34==34", "34!=2", "34!=34",
+                        R"=("This is test"== "This is test")=",
+                        R"=("abc" < "abd")=", "54>2!=5", "34+28-12/3",
+                        "34+(28-12)/3", "-4*(2+-3)", "!true", "!(1 < 2)",
+                        "true == !false", "((((1+2)*3)-4)/5)",
+                        "34325235235 * 3 == 102975705705",
+                        "140737488355327 + 1 > 140737488355327",
+                        "1 / (0 * -5) < 0", "6 / 3 == 2");
+    auto expr = parse_source(src);
+    auto chunk = Compiler().compile(expr);
+    VM vm;
+    INFO(src);
+    REQUIRE(vm.run(chunk) == std::visit(Interpreter(), expr));
+  }
+
+  SECTION("Exact integers") {
+    // Beyond 2^24, which float literals used to lose
+    auto expr = parse_source("34325235235 + 1");
+    REQUIRE(std::visit(Interpreter(), expr).as_number() == 34325235236.0);
+    VM vm;
+    REQUIRE(vm.run(Compiler().compile(expr)).as_number() == 34325235236.0);
+  }
+
+  SECTION("Stack depth") {
+    auto expr = parse_source("1+(2+(3+4))");
+    auto chunk = Compiler().compile(expr);
+    REQUIRE(chunk.max_stack_depth == 4);
+    REQUIRE(chunk.constants.size() == 4);
+  }
+
+  SECTION("Long constant pool") {
+    std::string src = "0";
+    for (int i = 1; i < 600; ++i)
+      src += fmt::format("+{}", i);
+    auto expr = parse_source(src);
+    auto chunk = Compiler().compile(expr);
+    REQUIRE(chunk.constants.size() == 600);
+    VM vm;
+    REQUIRE(vm.run(chunk).as_number() ==
+            std::visit(Interpreter(), expr).as_number());
+  }
+
+  SECTION("Chunk reuse") {
+    auto expr = parse_source("2*3 > 5");
+    auto chunk = Compiler().compile(expr);
+    VM vm;
+    for (int i = 0; i < 3; ++i)
+      REQUIRE(vm.run(chunk).as_bool());
+  }
+}
+
+TEST_CASE("VM.benchmark", "[.][VM][Benchmark]") {
+  auto expr = parse_source("(1+2)*3-4/5 > 2 == !(3 <= 4*(5-6)) != false");
+  auto chunk = Compiler().compile(expr);
+  VM vm;
+
+  BENCHMARK("Interpreter") { return std::visit(Interpreter(), expr); };
+  BENCHMARK("VM") { return vm.run(chunk); };
+}